@@ -0,0 +1,165 @@
+#ifdef AXIS2
+/* Second (lateral) motorized axis, and the job mode: a full 2-point stack at each of n_y() lateral positions.
+
+   The lateral axis only makes point-to-point moves from rest, with the same kind of equation of motion as in motor_control() (position as
+   a function of time since the start of the move): accelerating with AXIS2_ACCEL up to AXIS2_SPEED, and decelerating to a stop at the target.
+   The backlash is compensated by always finishing in the positive direction: backward moves overshoot by AXIS2_BACKLASH, and then make a
+   short forward leg.
+   motor2_control() is only called in the loops when the focusing motor didn't make a step, and it makes at most one microstep, so the
+   longest loop stays the same as with one axis.
+*/
+
+short n_y ()
+{
+  return pgm_read_word(&N_Y[g.i_n_y]);
+}
+
+
+void y_leg(long y1)
+/* Starting one leg of a lateral move, from the current position to y1.
+ */
+{
+  g.y0 = g.y_short_old;
+  if (y1 >= g.y0)
+    g.y_dir = 1;
+  else
+    g.y_dir = -1;
+  g.y_dist = (float)(g.y_dir * (y1 - g.y0));
+  // Acceleration phase; it is shorter (the speed profile is triangular) if the leg is too short to reach the full speed:
+  g.y_ta = AXIS2_SPEED / AXIS2_ACCEL;
+  if (AXIS2_ACCEL * g.y_ta * g.y_ta > g.y_dist)
+    g.y_ta = sqrt(g.y_dist / AXIS2_ACCEL);
+  g.y_v = AXIS2_ACCEL * g.y_ta;
+  // The deceleration takes as long as the acceleration, so the whole leg takes y_tc + y_ta:
+  g.y_tc = g.y_dist / g.y_v;
+  digitalWrite(PIN_DIR2, g.y_dir > 0 ? HIGH : LOW);
+  delayMicroseconds(STEP_LOW_DT);
+  g.t_y0 = clock_us();
+}
+
+
+void go_to2(long y1)
+/* Initiating a lateral move to y1 (from rest, and within the soft limits 0 ... AXIS2_LIMIT).
+ */
+{
+  if (g.y_moving || y1 == g.y_short_old || y1 < 0 || y1 > AXIS2_LIMIT)
+    return;
+
+  // The driver enable pin is shared with the focusing motor (the move starts once the driver is ready, in motor2_control()):
+  if (g.save_energy)
+    driver_enable();
+
+  g.y_target = y1;
+  if (y1 < g.y_short_old)
+  {
+    y_leg(y1 - AXIS2_BACKLASH);
+    g.y_moving = 1;
+  }
+  else
+  {
+    y_leg(y1);
+    g.y_moving = 2;
+  }
+  return;
+}
+
+
+void motor2_control()
+/* Making a lateral microstep when needed (at most one per call; if behind the equation of motion, it catches up in the following loops).
+ */
+{
+  if (g.y_moving == 0)
+    return;
+  if (driver_ready() == 0)
+  {
+    // The leg starts when the driver is ready:
+    g.t_y0 = clock_us();
+    return;
+  }
+
+  // Not using g.t, as it can be shifted by the skipped steps corrections of the focusing motor:
+  float dt = (float)(clock_us() - g.t_y0);
+  float d;
+  if (dt < g.y_ta)
+    // Accelerating:
+    d = 0.5 * AXIS2_ACCEL * dt * dt;
+  else if (dt < g.y_tc)
+    // Cruising:
+    d = g.y_v * (dt - 0.5 * g.y_ta);
+  else if (dt < g.y_tc + g.y_ta)
+    // Decelerating:
+  {
+    float dt1 = g.y_tc + g.y_ta - dt;
+    d = g.y_dist - 0.5 * AXIS2_ACCEL * dt1 * dt1;
+  }
+  else
+    d = g.y_dist;
+
+  long y_end = g.y0 + g.y_dir * (long)(g.y_dist + 0.5);
+  if (g.y0 + g.y_dir * (long)d != g.y_short_old)
+  {
+#ifndef DISABLE_MOTOR
+    digitalWrite(PIN_STEP2, LOW);
+    delayMicroseconds(STEP_LOW_DT);
+    digitalWrite(PIN_STEP2, HIGH);
+#endif
+    g.y_short_old = g.y_short_old + g.y_dir;
+  }
+  else if (g.y_short_old == y_end)
+    // The end of the leg:
+  {
+    if (g.y_moving == 1)
+    {
+      // Backlash compensation (the final forward leg):
+      y_leg(g.y_target);
+      g.y_moving = 2;
+    }
+    else
+      // (the driver is disabled by driver_idle())
+      g.y_moving = 0;
+  }
+  return;
+}
+
+
+byte job_init()
+/* Called when a new 2-point stack (or timelapse) is initiated: the job starts from the current lateral position.
+   Returns 0 if the lateral positions don't fit within the soft limits.
+ */
+{
+  g.y_counter = 0;
+  g.y_start = g.y_short_old;
+  if (g.y_start + (n_y() - 1) * AXIS2_DY > AXIS2_LIMIT)
+  {
+    display_comment_line("Bad Y grid!   ");
+    return 0;
+  }
+  return 1;
+}
+
+
+byte job_y_next()
+/* Called at the end of each 2-point stack (with the focusing rail at rest). Initiates the stack at the next lateral position, and returns 1;
+   or, if it was the last lateral position, sends the lateral axis back to the first one and returns 0 (the job is done).
+ */
+{
+  if (g.y_counter < n_y() - 1)
+  {
+    g.end_of_stacking = 0;
+    g.y_counter++;
+    // Both axes move at the same time; the next stack will start when both are at rest (in camera()):
+    go_to2(g.y_start + g.y_counter * AXIS2_DY);
+    go_to((float)g.point1 + 0.5, g.speed_limit);
+    g.stacker_mode = 1;
+    g.start_stacking = 0;
+    return 1;
+  }
+
+  if (g.y_counter > 0)
+  {
+    g.y_counter = 0;
+    go_to2(g.y_start);
+  }
+  return 0;
+}
+#endif
@@ -15,6 +15,16 @@ void backlash()
   // Don't do anything while calibrating.
   if (g.calibrate || g.breaking || g.moving || g.backlashing || g.BL_counter == (COORD_TYPE)0)
     return;
+#ifdef BL_MAP_DEBUG
+  // No compensation while the backlash is being measured near a limiter:
+  if (g.bl_cal_flag >= 3 && g.bl_cal_flag <= 5)
+    return;
+#endif
+#ifdef FAST_STARTUP
+  // Nor during the quick verify at the foreground limiter:
+  if (g.boot_flag > 1)
+    return;
+#endif
 
   if (g.backlash_init == 0)
   {
@@ -55,3 +65,159 @@ void backlash()
   return;
 }
 
+
+
+#ifdef BL_MAP
+COORD_TYPE local_backlash(float pos)
+/* Backlash (microsteps) at the rail position pos, linearly interpolated between the backlash map values at g.limit1 and g.limit2.
+   Rounded up, so the compensation is never shorter than the interpolated backlash.
+ */
+{
+  float x, bl;
+
+  if (g.limit2 <= g.limit1)
+    // Limits not known yet; using the worst case:
+    return max(g.bl_map[0], g.bl_map[1]);
+
+  // Relative position between the two limiters (0...1):
+  x = (pos - (float)g.limit1) / (float)(g.limit2 - g.limit1);
+  if (x < 0.0)
+    x = 0.0;
+  if (x > 1.0)
+    x = 1.0;
+  // The map is stored for the straight rail; in the reversed rail coordinates the foreground and background swap places:
+  if (g.straight == 0)
+    x = 1.0 - x;
+  bl = (float)g.bl_map[0] + x * (float)(g.bl_map[1] - g.bl_map[0]);
+
+  return (COORD_TYPE)ceil(bl);
+}
+
+
+void update_local_backlash(float pos)
+/* Setting g.backlash to the local backlash value at the position pos (the target of the next travel). Call this before every go_to.
+ */
+{
+  if (g.backlash_on == 0)
+    return;
+
+  g.backlash = local_backlash(pos);
+  // The rail cannot have more slack to take up than the local backlash:
+  if (g.BL_counter > g.backlash)
+    g.BL_counter = g.backlash;
+
+  return;
+}
+#endif
+
+
+#ifdef BL_MAP_DEBUG
+void backlash_measurement()
+/* Automatic backlash measurement at both limiters (initiated with "*#"), to fill the backlash map.
+
+   At each limiter the rail slowly approaches the limiter until it goes on (at the program coordinate P_on), and then reverses
+   until the limiter goes off (at P_off). After the reversal the motor first has to take up the backlash before the rail
+   starts moving, so |P_on - P_off| = backlash + limiter hysteresis. (The small overshoot after the limiter went on is travelled
+   twice, in both directions, so it cancels out.)
+ */
+{
+  byte limit_on;
+
+  if (g.bl_cal_flag == 0)
+    return;
+
+  if (g.error > 0 || g.calibrate > 0)
+    // Something else took over (e.g., we hit a limiter at full speed); giving up:
+  {
+    g.bl_cal_flag = 0;
+    return;
+  }
+
+  switch (g.bl_cal_flag)
+  {
+    case 1: // Travelling (normally) to the soft limit on the current side
+      if (g.moving || g.started_moving || g.backlashing || g.breaking)
+        return;
+      if (g.bl_cal_side > 0)
+        go_to((float)(g.limit2 - LIMITER_PAD2) + 0.5, g.speed_limit);
+      else
+        go_to((float)(g.limit1 + LIMITER_PAD2) + 0.5, g.speed_limit);
+      g.bl_cal_flag = 2;
+      break;
+
+    case 2: // Starting the slow approach to the limiter, once the rail is at rest and backlash compensated
+      if (g.moving || g.started_moving || g.backlashing || g.breaking || g.BL_counter > (COORD_TYPE)0)
+        return;
+      g.bl_cal_start = g.pos_short_old;
+      change_speed(g.bl_cal_side * SPEED_SCALE * BL_CAL_SPEED_MM_S, 0, 2);
+      g.bl_cal_flag = 3;
+      break;
+
+    case 3: // Approaching the limiter
+      limit_on = digitalRead(PIN_LIMITERS);
+      if (limit_on == HIGH)
+      {
+        g.bl_cal_on = g.pos_short_old;
+        // Reversing (at this speed, the breaking distance is a tiny fraction of a microstep):
+        change_speed(-g.bl_cal_side * SPEED_SCALE * BL_CAL_SPEED_MM_S, 0, 2);
+        g.bl_cal_flag = 4;
+      }
+      else if (g.bl_cal_side * (g.pos_short_old - g.bl_cal_start) > LIMITER_PAD2 + 2 * LIMITER_PAD)
+        // The limiter should have gone on long ago:
+      {
+        change_speed(0.0, 0, 2);
+        g.bl_cal_flag = 0;
+        display_comment_line(" No limiter!  ");
+      }
+      break;
+
+    case 4: // Backing off, until the limiter goes off
+      limit_on = digitalRead(PIN_LIMITERS);
+      if (limit_on == LOW)
+      {
+        g.bl_cal_value = g.bl_cal_side * (g.bl_cal_on - g.pos_short_old);
+        change_speed(0.0, 0, 2);
+        g.bl_cal_flag = 5;
+      }
+      break;
+
+    case 5: // Storing the result once stopped
+      if (g.moving || g.started_moving)
+        return;
+      g.bl_cal_value = g.bl_cal_value - LIMITER_HYSTERESIS + BL_MAP_PAD;
+      if (g.bl_cal_value < (COORD_TYPE)1)
+        g.bl_cal_value = 1;
+      // The map is stored for the straight rail:
+      if ((g.bl_cal_side > 0) == (g.straight == 1))
+        g.bl_map[1] = g.bl_cal_value;
+      else
+        g.bl_map[0] = g.bl_cal_value;
+
+      if (g.bl_cal_side > 0)
+        // Now the foreground limiter:
+      {
+        g.bl_cal_side = -1;
+        g.bl_cal_flag = 1;
+      }
+      else
+        // Both limiters are done
+      {
+        EEPROM.put( ADDR_BL_MAP, g.bl_map);
+        g.bl_cal_flag = 6;
+        // Travelling back into safe area:
+        go_to((float)(g.limit1 + 2 * BREAKING_DISTANCE) + 0.5, g.speed_limit);
+      }
+      break;
+
+    case 6: // Displaying the results once back in the safe area
+      if (g.moving || g.started_moving || g.backlashing)
+        return;
+      g.bl_cal_flag = 0;
+      sprintf(g.buffer, "BL= %4d %4d ", (int)constrain(g.bl_map[0], 0, 9999), (int)constrain(g.bl_map[1], 0, 9999));
+      display_comment_line(g.buffer);
+      break;
+  }
+
+  return;
+}
+#endif
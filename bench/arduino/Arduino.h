@@ -0,0 +1,98 @@
+/* Minimal Arduino core replacement for the host benchmark (see bench/bench.cpp).
+
+   Only what the sketch and the bundled Keypad / pcd8544 libraries actually use is declared here. All the pin functions,
+   the clock and the registers are implemented by the benchmark itself (virtual clock and rail model).
+*/
+#ifndef BENCH_ARDUINO_H
+#define BENCH_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+using std::max;
+using std::min;
+
+#define ARDUINO 106
+#define F_CPU 16000000UL
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef unsigned int word;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define MSBFIRST 1
+#define LSBFIRST 0
+#define PI 3.1415926535897932384626433832795
+
+// Arduino Uno pin numbers:
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define SS 10
+#define MOSI 11
+#define SCK 13
+
+// Flash memory is ordinary memory on the host:
+#define PROGMEM
+#define F(x) (x)
+#define pgm_read_byte(a) (*(const uint8_t*)(a))
+#define pgm_read_word(a) (*(const uint16_t*)(a))
+#define pgm_read_dword(a) (*(const uint32_t*)(a))
+#define pgm_read_float(a) (*(const float*)(a))
+
+#define bitRead(v, b) (((v) >> (b)) & 1)
+#define bitSet(v, b) ((v) |= (1UL << (b)))
+#define bitClear(v, b) ((v) &= ~(1UL << (b)))
+#define bitWrite(v, b, x) ((x) ? bitSet(v, b) : bitClear(v, b))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define _BV(b) (1 << (b))
+
+// Interrupts are called directly by the rail model (no concurrency on the host):
+#define ISR(v) void v(void)
+#define cli()
+#define sei()
+#define noInterrupts()
+#define interrupts()
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+void shiftOut(uint8_t data_pin, uint8_t clock_pin, uint8_t bit_order, uint8_t val);
+// Note: on the host unsigned long is 64 bits, so the virtual clock never wraps around (it does after ~71 min on Arduino):
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// avr-libc extensions of stdlib.h:
+inline char* itoa(int val, char* s, int)
+{
+  sprintf(s, "%d", val);
+  return s;
+}
+inline char* ltoa(long val, char* s, int)
+{
+  sprintf(s, "%ld", val);
+  return s;
+}
+
+#include "avr_regs.h"
+
+// Pin change interrupt registers and bits for the Arduino Uno pins (same as in the Arduino core):
+#define digitalPinToPCICRbit(p) (((p) <= 7) ? 2 : (((p) <= 13) ? 0 : 1))
+#define digitalPinToPCMSK(p) (((p) <= 7) ? &PCMSK2 : (((p) <= 13) ? &PCMSK0 : &PCMSK1))
+#define digitalPinToPCMSKbit(p) (((p) <= 7) ? (p) : (((p) <= 13) ? ((p) - 8) : ((p) - 14)))
+
+#endif
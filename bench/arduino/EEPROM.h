@@ -0,0 +1,47 @@
+/* 1 kB EEPROM of ATmega328P kept in host memory (host benchmark). */
+#ifndef BENCH_EEPROM_H
+#define BENCH_EEPROM_H
+
+#include "Arduino.h"
+
+// Virtual time of one byte write (implemented by the benchmark):
+void eeprom_write_time();
+
+struct EEPROMClass
+{
+  uint8_t mem[1024];
+  uint8_t read(int addr)
+  {
+    return mem[addr];
+  }
+  void write(int addr, uint8_t val)
+  {
+    eeprom_write_time();
+    mem[addr] = val;
+  }
+  void update(int addr, uint8_t val)
+  {
+    if (mem[addr] != val)
+      write(addr, val);
+  }
+  uint16_t length()
+  {
+    return sizeof(mem);
+  }
+  template <typename T> T& get(int addr, T& t)
+  {
+    memcpy(&t, mem + addr, sizeof(T));
+    return t;
+  }
+  // Like in the Arduino library, only the bytes which changed are written:
+  template <typename T> const T& put(int addr, const T& t)
+  {
+    const uint8_t *p = (const uint8_t *)&t;
+    for (unsigned int i = 0; i < sizeof(T); i++)
+      update(addr + i, p[i]);
+    return t;
+  }
+};
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,34 @@
+/* Print base class of the Arduino core (host benchmark); only what pcd8544 uses. */
+#ifndef BENCH_PRINT_H
+#define BENCH_PRINT_H
+
+#include "Arduino.h"
+
+class Print
+{
+  public:
+    virtual size_t write(uint8_t c) = 0;
+    size_t print(const char* s)
+    {
+      size_t n = 0;
+      while (*s)
+        n += write(*s++);
+      return n;
+    }
+    size_t print(char c)
+    {
+      return write(c);
+    }
+    size_t print(long v)
+    {
+      char buf[12];
+      sprintf(buf, "%ld", v);
+      return print(buf);
+    }
+    size_t print(int v)
+    {
+      return print((long)v);
+    }
+};
+
+#endif
@@ -0,0 +1,25 @@
+/* Hardware SPI (host benchmark): pcd8544 writes straight to SPDR, so only the setup calls are needed here. */
+#ifndef BENCH_SPI_H
+#define BENCH_SPI_H
+
+#include "Arduino.h"
+
+#define SPI_CLOCK_DIV4 0x00
+#define SPI_CLOCK_DIV16 0x01
+#define SPI_CLOCK_DIV64 0x02
+#define SPI_CLOCK_DIV128 0x03
+#define SPI_CLOCK_DIV2 0x04
+#define SPI_CLOCK_DIV8 0x05
+#define SPI_CLOCK_DIV32 0x06
+
+class SPIClass
+{
+  public:
+    void begin() {}
+    void setBitOrder(uint8_t) {}
+    void setDataMode(uint8_t) {}
+    void setClockDivider(uint8_t) {}
+};
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,2 @@
+// Pre-1.0 Arduino core header name (host benchmark):
+#include "Arduino.h"
@@ -0,0 +1,2 @@
+// PROGMEM and pgm_read_* are defined in Arduino.h (host benchmark):
+#include "Arduino.h"
@@ -0,0 +1,13 @@
+/* Sleep modes (host benchmark). sleep_cpu() is implemented by the benchmark: it advances the virtual clock to the next
+   Timer0 overflow, or less if a key is pressed (pin change interrupt).
+*/
+#ifndef BENCH_SLEEP_H
+#define BENCH_SLEEP_H
+
+#define SLEEP_MODE_IDLE 0
+#define set_sleep_mode(mode)
+#define sleep_enable()
+#define sleep_disable()
+void sleep_cpu();
+
+#endif
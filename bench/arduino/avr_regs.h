@@ -0,0 +1,71 @@
+/* ATmega328P registers used by the sketch and the libraries (host benchmark).
+   Plain variables, except for SPDR: every byte written to it costs virtual time (the LCD traffic is a large part of
+   the real loop time), and the Timer1 counter and flags.
+*/
+#ifndef BENCH_AVR_REGS_H
+#define BENCH_AVR_REGS_H
+
+#include <stdint.h>
+
+struct spi_data_reg
+{
+  void operator=(uint8_t data);
+};
+extern spi_data_reg SPDR;
+
+// Timer1 counter: reads follow the virtual clock (2 MHz, prescaler 8):
+struct timer1_count_reg
+{
+  operator uint16_t();
+  void operator=(uint16_t count);
+};
+extern timer1_count_reg TCNT1;
+
+// Timer1 interrupt flags: the overflow interrupt is never pending when the sketch reads them (see TCNT1), so they always read 0:
+struct timer1_flag_reg
+{
+  operator uint8_t() { return 0; }
+  void operator=(uint8_t) {}
+};
+extern timer1_flag_reg TIFR1;
+
+extern volatile uint8_t SPCR, SPSR;
+extern volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+extern volatile uint8_t PINB, PIND;
+extern volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UDR0;
+extern volatile uint16_t UBRR0;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+extern volatile uint8_t SREG;
+
+// SPI:
+#define SPR0 0
+#define SPR1 1
+#define CPHA 2
+#define CPOL 3
+#define MSTR 4
+#define DORD 5
+#define SPE 6
+#define SPIE 7
+#define SPIF 7
+#define SPI2X 0
+// Pin change interrupts:
+#define PCIE0 0
+#define PCIF0 0
+#define PCINT0 0
+#define PCINT1 1
+#define PINB0 0
+#define PINB1 1
+#define PIND1 1
+// UART:
+#define U2X0 1
+#define UDRE0 5
+#define UDRIE0 5
+#define TXEN0 3
+#define UCSZ00 1
+#define UCSZ01 2
+// Timer1:
+#define CS11 1
+#define TOV1 0
+#define TOIE1 0
+
+#endif
@@ -0,0 +1,2 @@
+// Pin definitions are in Arduino.h (host benchmark):
+#include "Arduino.h"
@@ -0,0 +1,7 @@
+// Interrupts never run concurrently with the sketch on the host, so atomic blocks are plain blocks (host benchmark):
+#ifndef BENCH_ATOMIC_H
+#define BENCH_ATOMIC_H
+#define ATOMIC_BLOCK(type)
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#endif
@@ -0,0 +1,1761 @@
+/* Scenario benchmark for the motion and stacking core, compiled and run on a Linux host.
+
+   The whole sketch (setup(), loop(), and everything they call) runs unmodified against a virtual clock and a model
+   of the rail, so different firmware revisions and options can be compared on throughput and accuracy.
+
+   Building and running (from the sketch directory):
+
+     python3 bench/ino2cpp.py . /tmp/stacker_sketch.cpp
+     g++ -std=gnu++11 -O2 -Wall -Wextra -Werror -I bench/arduino -I . -I /tmp bench/bench.cpp Keypad.cpp Key.cpp pcd8544.cpp -o /tmp/stacker_bench
+     /tmp/stacker_bench [-l LOOP_US] [-a ACCEL_I] [-b] [-t PREFIX] [scenario ...] > bench_output.txt
+
+   With -a, the acceleration factor ACCEL_FACTOR[ACCEL_I] is used instead of the factory default one. With -b, the rail runs from batteries
+   (the slower speed limit SPEED_LIMIT2 is used).
+
+   With -t, every scenario is also traced to PREFIX_<scenario>.vcd (Value Change Dump, 1 us resolution; can be viewed with GTKWave):
+   the pins STEP, DIR, ENABLE, SHUTTER, AF and LIMITERS, and the firmware variables stacker_mode, noncont_flag and accel. The trace is
+   sampled on every pin write and read and every micros() call, so it shows the pins as the firmware saw them.
+
+   Compile options of the sketch can be added to the g++ line (e.g. -DMICROSTEP_SWITCH); all of them build without warnings. RAM_DEBUG can't be
+   used here.
+
+   bench/sweep.py builds and runs the bench for many combinations of the motion settings (speed limits, breaking distance,
+   acceleration factors, limiter paddings), in parallel, and recommends the fastest safe ones.
+
+   The model:
+    - Virtual clock: every loop() costs LOOP_US microseconds (+-20% pseudo-random jitter, always the same sequence), plus
+      every delay() / delayMicroseconds() the sketch makes, plus LCD_BYTE_US for every byte sent to the LCD. micros() has a 4 us
+      resolution, as on a 16 MHz AVR; with TIMER1_CLOCK, the Timer1 counter follows the virtual clock at 2 MHz, and its overflow
+      interrupt is called for every overflow before the counter is read.
+    - Rail: PIN_STEP pulses move the motor (one microstep, or a full step when PIN_MS is LOW); the carriage follows the
+      motor with a play of RAIL_PLAY microsteps (the real backlash; the firmware compensates for BACKLASH, which should
+      be larger). The carriage is pushed by the motor in the positive direction.
+    - Step loss: every hw.slip_every-th pulse (if not 0) the motor slips back by four full steps (one pole slip), one microstep at a time.
+    - ACCEL_TUNE: the payload can only be accelerated at up to hw.accel_max times ACCEL_LIMIT (if not 0): every 64th pulse made while the
+      commanded acceleration is larger than that is a pole slip.
+    - ENCODER: the encoder channels follow the motor position (2*ENCODER_LINES counts per rotation), and the PCINT0 interrupt is called on
+      every change of the channel A.
+    - AXIS2: PIN_STEP2 pulses move the lateral motor by one microstep; its carriage follows with a play of
+      AXIS2_PLAY microsteps, the same way.
+    - The limiting switches are on when the carriage is at or beyond SWITCH1 / SWITCH2 (the PCINT0 interrupt is called
+      on every change, as on the real hardware).
+    - EEPROM: a byte write takes EEPROM_WRITE_US; writing a byte waits until the previous write is finished (as eeprom_write_byte() does).
+    - Keys are pressed and released through the emulated 4x4 matrix, so the keypad library and process_keypad() run
+      as usual.
+    - IDLE_SLEEP: the idle sleep lasts until the next Timer0 overflow (every 1024 us of the virtual clock).
+    - Camera: a shot is missed if the camera buffer (the current camera model in CAMERAS; one frame per shot, emptied at the sustained
+      frame rate) is full.
+    - FLASH_SYNC: the flash sync pin goes LOW for one loop FLASH_LATENCY_US (+0...50%) after the shutter is triggered for an exposure
+      (non-continuous stacking, not the mirror lock-up), except for every hw.flash_miss-th exposure (if not 0), which is missed.
+    - STOP_AND_GO: the carriage travel within STOP_AND_GO_EXPOSURE_US after each shutter actuation is the motion blur of that frame.
+    - INPUT_SHAPER: the camera sits on the carriage on a spring (RING_HZ, damping ratio RING_ZETA), so it rings after every move; its
+      distance from the carriage at the moment of shutter actuation is the vibration of that frame.
+    - JOB_QUEUE: the power can be switched off and on between two stacks; the EEPROM and the rail position are kept.
+    - Startup: the power can be switched off and on at any time, even while the rail is moving (the rail stops right away); the EEPROM and the
+      motor and carriage positions are kept.
+    - Battery voltage is above SPEED_VOLTAGE (AC power, the faster speed limit is used), or below it with -b.
+
+   Output: one line of JSON per scenario:
+     t_stack_s         - virtual (rail) time per stack, from the key press until the rail is at rest again
+     host_s            - host time spent for the whole scenario
+     steps, steps_per_s - microsteps travelled by the motor, and their number per virtual second
+     pulses            - number of pulses sent to the driver
+     shots             - number of shutter actuations (two per frame in non-continuous stacking with mirror lock)
+     missed_shots      - shots the camera would miss, because its buffer was full
+     shot_error_max    - largest carriage position error at the moment of shutter actuation, in microsteps (only the shots on the
+                         straight rail)
+     pos_error         - final carriage position error, in microsteps (for calibration: largest error of the two
+                         limiter positions found by calibration; for the AXIS2 job: largest lateral carriage error
+                         at the moments of shutter actuation; for the stop-and-go stack: largest motion blur, in microsteps;
+                         for the ringing stacks: largest camera vibration at the moments of shutter actuation, in nm; for the
+                         moves cycle: largest overshoot of the motor beyond the target of a go_to() move, in microsteps)
+                         (for the startup scenarios, t_stack_s is the time from power-up until the rail is ready)
+     awake_pct         - percentage of the virtual time the MCU was not sleeping (IDLE_SLEEP)
+     skipped_steps     - motor_control() calls which had to make up for more than one microstep (the cases corrected
+                         by PRECISE_STEPPING)
+     limiter_margin    - smallest distance between the carriage and a limiting switch over the whole scenario, in microsteps (0 or
+                         less: the switch went on, as it does during calibration)
+     restarts, restart_us_max - moves initiated in the loop right after the rail stopped (e.g. the backlash compensation legs), and
+                         the longest time from the stop to the start of such a move (the end of the loop which started the motion), us
+     unready_pulses    - step pulses sent while the driver was disabled, or less than ENABLE_DELAY_MS after it was enabled (should be 0)
+     loop_ns_p50 ... loop_ns_max - host time per loop() call (percentiles), in nanoseconds
+
+   With -t, one more line of JSON per scenario (the analysis of the trace, over the whole scenario):
+     events            - value changes written to the VCD file
+     step_intervals    - intervals between consecutive step pulses at a constant speed (accel=0, same direction and speed)
+     step_interval_min_us, step_jitter_rms_us, step_jitter_max_us - the shortest such interval, and the deviation of the intervals
+                         from 1/|speed| (the timing jitter of motor_control(), mostly the loop duration)
+     af_shutter_n, af_shutter_min_us, af_shutter_max_us - time from AF on to shutter on (only the first shot after AF went on)
+     af_shutter_short  - of them, shorter than SHUTTER_ON_DELAY (SHUTTER_ON_DELAY2 with the mirror lock-up)
+     exposures, exposures_moving, steps_exposed - shutter actuations, the ones with step pulses while the shutter was on, and the
+                         number of those pulses (expected in continuous stacking; should be 0 in non-continuous stacking)
+*/
+
+#include "stacker_sketch.cpp"
+
+#include <time.h>
+
+EEPROMClass EEPROM;
+SPIClass SPI;
+
+// The average duration of one loop() on Arduino (without the LCD traffic), in us. Can be changed with -l:
+unsigned long LOOP_US = 200;
+// Acceleration factor used after power-up (index in ACCEL_FACTOR; -1: the factory default). Can be changed with -a:
+char ACCEL_I = -1;
+// 1: battery power, below SPEED_VOLTAGE (the slower speed limit SPEED_LIMIT2 is used). Set with -b:
+byte BATTERY = 0;
+// Time to send one byte to the LCD (hardware SPI at 2 MHz, plus the D/C pin write), us:
+const unsigned long LCD_BYTE_US = 6;
+// Same, for SOFTWARE_SPI:
+const unsigned long LCD_SHIFTOUT_US = 110;
+// Time to write one EEPROM byte (erase and write), us:
+const unsigned long EEPROM_WRITE_US = 3400;
+// Real play of the rail (smaller than BACKLASH, as it should be), microsteps:
+const COORD_TYPE RAIL_PLAY = BACKLASH * 3 / 4;
+// Carriage positions where the two limiting switches go on, microsteps:
+const COORD_TYPE SWITCH1 = -LIMITER_PAD;
+const COORD_TYPE SWITCH2 = (COORD_TYPE)RAIL_MICROSTEPS - LIMITER_PAD;
+// Number of shots whose carriage positions are logged:
+const short N_SHOT_LOG = 256;
+#ifdef FLASH_SYNC
+// Shutter-to-flash latency of the camera, us:
+const unsigned long FLASH_LATENCY_US = 60000;
+#endif
+#ifdef INPUT_SHAPER
+// Natural frequency (Hz) and damping ratio of the camera on the carriage (the same as the shaper model 1):
+const float RING_HZ = 12.0;
+const float RING_ZETA = 0.05;
+#endif
+#ifdef AXIS2
+// Real play of the lateral axis, microsteps:
+const long AXIS2_PLAY = AXIS2_BACKLASH * 3 / 4;
+#endif
+// Longest loop time which goes into the histogram of loop times (longer ones are counted in the last bin), and the bin width, ns:
+const unsigned long HIST_MAX_NS = 200000;
+const unsigned long HIST_BIN_NS = 10;
+
+// Registers:
+spi_data_reg SPDR;
+volatile uint8_t SPCR, SPSR = _BV(SPIF);
+volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+volatile uint8_t PINB, PIND;
+volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UDR0;
+volatile uint16_t UBRR0;
+timer1_count_reg TCNT1;
+timer1_flag_reg TIFR1;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+volatile uint8_t SREG;
+
+// The state of the virtual hardware:
+struct bench_hw
+{
+  unsigned long t;  // Virtual clock, us
+  unsigned long jitter;  // Pseudo-random state for the loop duration jitter
+  byte level[20];  // Last value written to each pin
+  byte mode[20];  // pinMode for each pin
+  COORD_TYPE motor;  // Motor position, microsteps
+  COORD_TYPE carriage;  // Carriage position, microsteps (motor <= carriage <= motor + RAIL_PLAY)
+  byte limiter;  // 1 when a limiting switch is on
+  unsigned long pulses;  // Pulses sent to the driver
+  unsigned long steps;  // Microsteps made by the motor
+  unsigned long slip_every;  // Every slip_every-th pulse the motor slips (0: never)
+  float accel_max;  // Largest acceleration of the payload without slipping, in units of ACCEL_LIMIT (0: no limit)
+  unsigned long overdriven;  // Pulses made at a larger acceleration than that
+  char pressed[2];  // Keys currently pressed (0: none)
+  COORD_TYPE offset;  // motor - g.pos_short_old (firmware coordinates to motor coordinates)
+  COORD_TYPE pos_to_shoot;  // g.pos_to_shoot at the beginning of the current loop
+  COORD_TYPE shot_target;  // Firmware coordinate of the frame being shot
+  unsigned long shots;
+  COORD_TYPE shot_error_max;
+  COORD_TYPE shot_log[N_SHOT_LOG];  // Carriage positions (firmware coordinates) of the first N_SHOT_LOG shots
+  float cam_buffer;  // Frames in the camera buffer, at the time of the last shot
+  unsigned long t_last_shot;
+  unsigned long missed_shots;
+  unsigned long skipped_steps;
+  COORD_TYPE margin_min;  // Smallest distance between the carriage and a limiting switch
+  byte restart;  // 1: the rail stopped in the last loop; 2: a move was initiated right after the stop, waiting for the motion to start
+  unsigned long t_stop;  // Time of the stop
+  unsigned long restarts;
+  unsigned long restart_max;
+  unsigned long t_enable;  // Time when PIN_ENABLE went LOW (the driver was enabled)
+  unsigned long unready_pulses;
+  unsigned long loops;
+  unsigned long t_sleep;  // Virtual time spent in the idle sleep, us
+  unsigned long t_eeprom;  // Time when the last EEPROM write will be finished
+  unsigned long t1_start;  // Time when the Timer1 counter was cleared
+  unsigned long t1_ovf;  // Timer1 overflows since then, with the interrupt serviced
+  byte (*done)();  // End of the scenario condition, while in run_until()
+  unsigned long loop_ns_max;
+  unsigned long hist[HIST_MAX_NS / HIST_BIN_NS + 1];  // Histogram of loop() host times
+#ifdef FLASH_SYNC
+  byte flash;  // 1: the flash will fire at t_flash; 2: the flash sync pin is LOW
+  unsigned long t_flash;
+  unsigned long exposures;
+  unsigned long flash_miss;  // Every flash_miss-th exposure is missed (0: none)
+#endif
+#ifdef AXIS2
+  long y_motor;  // Lateral motor position, microsteps
+  long y_carriage;  // Lateral carriage position, microsteps (y_motor <= y_carriage <= y_motor + AXIS2_PLAY)
+  long y_error_max;  // Largest lateral carriage error at the moment of shutter actuation
+#endif
+#ifdef STOP_AND_GO
+  unsigned long t_exposure;  // Time of the last shutter actuation
+  COORD_TYPE exposure_carriage;  // Carriage position at that time
+  COORD_TYPE blur_max;  // Largest carriage travel within STOP_AND_GO_EXPOSURE_US after a shutter actuation
+#endif
+#ifdef INPUT_SHAPER
+  float ring_y;  // Camera position, microsteps
+  float ring_v;  // Camera speed, microsteps/us
+  COORD_TYPE ring_carriage;  // Carriage position at t_ring
+  unsigned long t_ring;  // Time up to which the camera motion was integrated
+  float ring_max;  // Largest distance between the camera and the carriage at a shutter actuation, microsteps
+#endif
+};
+bench_hw hw;
+
+
+//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Pin-level trace (-t): a Value Change Dump of the pins and of a few firmware variables, and its analysis.
+
+// Traced pins, and the VCD names:
+const byte N_TRACE_PINS = 6;
+const byte TRACE_PINS[N_TRACE_PINS] = {PIN_STEP, PIN_DIR, PIN_ENABLE, PIN_SHUTTER, PIN_AF, PIN_LIMITERS};
+const char *TRACE_PIN_NAMES[N_TRACE_PINS] = {"STEP", "DIR", "ENABLE", "SHUTTER", "AF", "LIMITERS"};
+// Virtual signals (firmware variables), 8 bits each:
+const byte N_TRACE_VARS = 3;
+const char *TRACE_VAR_NAMES[N_TRACE_VARS] = {"stacker_mode", "noncont_flag", "accel"};
+
+struct bench_trace
+{
+  FILE *vcd;  // Not tracing if 0
+  unsigned long t_last;  // Time of the last "#t" line written
+  unsigned long events;  // Value changes written
+  byte pin[N_TRACE_PINS];  // Last values written
+  byte var[N_TRACE_VARS];
+  // Step intervals at a constant speed (accel=0) vs the ideal interval 1/|speed|:
+  unsigned long t_step;  // Time of the previous step pulse (0: none in this constant speed phase)
+  float speed_step;  // g.speed at the previous step pulse
+  byte dir_step;  // PIN_DIR at the previous step pulse
+  unsigned long n_intervals;
+  double jitter_sum2;
+  float jitter_max;
+  unsigned long interval_min;
+  // AF on to shutter on (when AF was switched on for the shot):
+  unsigned long t_af;
+  unsigned long n_af;
+  unsigned long af_min, af_max;
+  unsigned long af_short;  // Shorter than SHUTTER_ON_DELAY (SHUTTER_ON_DELAY2 with mirror_lock=2)
+  // Exposures (shutter on):
+  unsigned long exposures;
+  unsigned long exposures_moving;  // Exposures with at least one step pulse
+  unsigned long steps_exposed;  // Step pulses during exposures
+  byte moved;  // A step pulse during the current exposure
+};
+bench_trace tr;
+
+
+byte trace_var(byte i)
+{
+  switch (i)
+  {
+    case 0:
+      return g.stacker_mode;
+    case 1:
+      return g.noncont_flag;
+  }
+  return (byte)g.accel;
+}
+
+
+void trace_step()
+/* Step pulse statistics (called on each rising edge of PIN_STEP, before the new level is traced).
+ */
+{
+  unsigned long t = hw.t;
+  if (tr.pin[3])
+  {
+    tr.steps_exposed++;
+    tr.moved = 1;
+  }
+  float v = fabs(g.speed);
+#ifdef MICROSTEP_SWITCH
+  if (hw.level[PIN_MS] == LOW)
+    v = v / N_MICROSTEPS;
+#endif
+  if (g.accel != 0 || v < SPEED_TINY)
+  {
+    tr.t_step = 0;
+    return;
+  }
+  if (tr.t_step && g.speed == tr.speed_step && hw.level[PIN_DIR] == tr.dir_step)
+  {
+    unsigned long dt = t - tr.t_step;
+    float jitter = (float)dt - 1.0 / v;
+    tr.n_intervals++;
+    tr.jitter_sum2 += jitter * jitter;
+    if (fabs(jitter) > tr.jitter_max)
+      tr.jitter_max = fabs(jitter);
+    if (dt < tr.interval_min)
+      tr.interval_min = dt;
+  }
+  tr.t_step = t;
+  tr.speed_step = g.speed;
+  tr.dir_step = hw.level[PIN_DIR];
+}
+
+
+void trace_shutter(byte on)
+/* AF-to-shutter spacing and exposure statistics (called when PIN_SHUTTER changes, before the new level is traced).
+ */
+{
+  if (on)
+  {
+    tr.moved = 0;
+    if (tr.pin[4] && tr.t_af)
+    {
+      unsigned long dt = hw.t - tr.t_af;
+      unsigned long dt_min = g.mirror_lock == 2 ? SHUTTER_ON_DELAY2 : SHUTTER_ON_DELAY;
+      tr.n_af++;
+      tr.af_min = min(tr.af_min, dt);
+      tr.af_max = max(tr.af_max, dt);
+      if (dt < dt_min)
+        tr.af_short++;
+    }
+    // Only the first shot after AF went on:
+    tr.t_af = 0;
+  }
+  else
+  {
+    tr.exposures++;
+    if (tr.moved)
+      tr.exposures_moving++;
+  }
+}
+
+
+void trace_sample()
+/* The trace hook, called on every pin write and read, and every micros() call: writing all the changes since the previous call.
+ */
+{
+  if (tr.vcd == 0)
+    return;
+  byte i;
+  for (i = 0; i < N_TRACE_PINS + N_TRACE_VARS; i++)
+  {
+    byte v, *old;
+    if (i < N_TRACE_PINS)
+    {
+      v = TRACE_PINS[i] == PIN_LIMITERS ? hw.limiter : hw.level[TRACE_PINS[i]];
+      old = &tr.pin[i];
+    }
+    else
+    {
+      v = trace_var(i - N_TRACE_PINS);
+      old = &tr.var[i - N_TRACE_PINS];
+    }
+    if (v == *old)
+      continue;
+    if (i == 0 && v)
+      trace_step();
+    else if (i == 3)
+      trace_shutter(v);
+    else if (i == 4 && v)
+      tr.t_af = hw.t;
+    *old = v;
+    if (hw.t != tr.t_last)
+    {
+      fprintf(tr.vcd, "#%lu\n", hw.t);
+      tr.t_last = hw.t;
+    }
+    if (i < N_TRACE_PINS)
+      fprintf(tr.vcd, "%d%c\n", v, '!' + i);
+    else
+    {
+      fputc('b', tr.vcd);
+      for (char b = 7; b >= 0; b--)
+        fputc('0' + ((v >> b) & 1), tr.vcd);
+      fprintf(tr.vcd, " %c\n", '!' + i);
+    }
+    tr.events++;
+  }
+}
+
+
+void trace_open(const char *prefix, const char *name)
+/* Starting the trace of one scenario: prefix_name.vcd (all the signals are 0 at the start, before power up).
+ */
+{
+  char file[256];
+  snprintf(file, sizeof(file), "%s_%s.vcd", prefix, name);
+  memset(&tr, 0, sizeof(tr));
+  tr.interval_min = ~0UL;
+  tr.af_min = ~0UL;
+  tr.vcd = fopen(file, "w");
+  if (tr.vcd == 0)
+  {
+    fprintf(stderr, "Can't write %s\n", file);
+    return;
+  }
+  fprintf(tr.vcd, "$comment Fast Stacker bench: %s $end\n$timescale 1us $end\n$scope module stacker $end\n", name);
+  for (byte i = 0; i < N_TRACE_PINS; i++)
+    fprintf(tr.vcd, "$var wire 1 %c %s $end\n", '!' + i, TRACE_PIN_NAMES[i]);
+  for (byte i = 0; i < N_TRACE_VARS; i++)
+    fprintf(tr.vcd, "$var wire 8 %c %s $end\n", '!' + N_TRACE_PINS + i, TRACE_VAR_NAMES[i]);
+  fprintf(tr.vcd, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n");
+  for (byte i = 0; i < N_TRACE_PINS; i++)
+    fprintf(tr.vcd, "0%c\n", '!' + i);
+  for (byte i = 0; i < N_TRACE_VARS; i++)
+    fprintf(tr.vcd, "b00000000 %c\n", '!' + N_TRACE_PINS + i);
+  fprintf(tr.vcd, "$end\n");
+}
+
+
+void trace_close(const char *name)
+/* Finishing the trace, and printing its analysis (one line of JSON).
+ */
+{
+  if (tr.vcd == 0)
+    return;
+  fclose(tr.vcd);
+  tr.vcd = 0;
+  printf("{\"trace\": \"%s\", \"events\": %lu, \"step_intervals\": %lu, \"step_interval_min_us\": %lu, \"step_jitter_rms_us\": %.1f, "
+         "\"step_jitter_max_us\": %.1f, \"af_shutter_n\": %lu, \"af_shutter_min_us\": %lu, \"af_shutter_max_us\": %lu, \"af_shutter_short\": %lu, "
+         "\"exposures\": %lu, \"exposures_moving\": %lu, \"steps_exposed\": %lu}\n",
+         name, tr.events, tr.n_intervals, tr.n_intervals ? tr.interval_min : 0, tr.n_intervals ? sqrt(tr.jitter_sum2 / tr.n_intervals) : 0.0,
+         tr.jitter_max, tr.n_af, tr.n_af ? tr.af_min : 0, tr.af_max, tr.af_short, tr.exposures, tr.exposures_moving, tr.steps_exposed);
+  fflush(stdout);
+}
+
+
+//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Arduino functions:
+
+void spi_data_reg::operator=(uint8_t)
+{
+  hw.t += LCD_BYTE_US;
+}
+
+unsigned long micros()
+// (4 us resolution, as on a 16 MHz AVR)
+{
+  trace_sample();
+  return hw.t & ~3UL;
+}
+
+timer1_count_reg::operator uint16_t()
+/* Timer1 counts at 2 MHz from the moment it was cleared. The overflow interrupts up to now are serviced first.
+ */
+{
+  trace_sample();
+  unsigned long ticks = 2 * (hw.t - hw.t1_start);
+#ifdef TIMER1_CLOCK
+  while (hw.t1_ovf < ticks >> 16)
+  {
+    hw.t1_ovf++;
+    TIMER1_OVF_vect();
+  }
+#endif
+  return (uint16_t)ticks;
+}
+
+void timer1_count_reg::operator=(uint16_t)
+// (only clearing the counter is used)
+{
+  hw.t1_start = hw.t;
+  hw.t1_ovf = 0;
+}
+
+unsigned long millis()
+{
+  return hw.t / 1000;
+}
+
+void sleep_cpu()
+/* Sleeping until the next Timer0 overflow (keys pressed before the sleep are seen by the sketch, so no pin change interrupts happen here).
+   If the scenario is already over, the sketch is woken up, so that the scenario time doesn't include the idle sleep after the end.
+ */
+{
+  unsigned long dt = 1024 - hw.t % 1024;
+  hw.t += dt;
+  hw.t_sleep += dt;
+#ifdef IDLE_SLEEP
+  if (hw.done && hw.done())
+    g.wakeup = 1;
+#endif
+}
+
+void eeprom_write_time()
+{
+  if (hw.t < hw.t_eeprom)
+    hw.t = hw.t_eeprom;
+  hw.t_eeprom = hw.t + EEPROM_WRITE_US;
+}
+
+void delay(unsigned long ms)
+{
+  hw.t += 1000 * ms;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  hw.t += us;
+}
+
+void shiftOut(uint8_t, uint8_t, uint8_t, uint8_t)
+{
+  hw.t += LCD_SHIFTOUT_US;
+}
+
+int analogRead(uint8_t)
+{
+  // Battery: 8 x 1.5V (AC power), or 8 x 1.33V (-b):
+  return BATTERY ? 800 : 900;
+}
+
+void analogWrite(uint8_t, int)
+{
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  hw.mode[pin] = mode;
+}
+
+
+#ifdef ENCODER
+void encoder_pins()
+/* The encoder channels for the current motor position (a quarter of the quadrature cycle is ENCODER_MSTEPS/2 microsteps).
+ */
+{
+  long q = 2 * (long)hw.motor;
+  q = (q >= 0 ? q : q - ENCODER_MSTEPS + 1) / ENCODER_MSTEPS;
+  byte p = q & 3;
+  byte a = p == 1 || p == 2;
+  if (p >= 2)
+    PIND |= _BV(PIND1);
+  else
+    PIND &= ~_BV(PIND1);
+  if (a == ((PINB & _BV(PINB1)) != 0))
+    return;
+  if (a)
+    PINB |= _BV(PINB1);
+  else
+    PINB &= ~_BV(PINB1);
+  if ((PCICR & _BV(PCIE0)) && (PCMSK0 & _BV(PCINT1)))
+    PCINT0_vect();
+}
+#endif
+
+
+void motor_step(COORD_TYPE d)
+/* Moving the motor by d microsteps (one at a time, for the encoder), then the carriage, then checking the limiters.
+ */
+{
+  char dir = d > 0 ? 1 : -1;
+  for (COORD_TYPE i = 0; i != d; i += dir)
+  {
+    hw.motor += dir;
+#ifdef ENCODER
+    encoder_pins();
+#endif
+  }
+
+  if (hw.carriage < hw.motor)
+    hw.carriage = hw.motor;
+  else if (hw.carriage > hw.motor + RAIL_PLAY)
+    hw.carriage = hw.motor + RAIL_PLAY;
+#ifdef STOP_AND_GO
+  if (hw.t - hw.t_exposure < STOP_AND_GO_EXPOSURE_US && abs(hw.carriage - hw.exposure_carriage) > hw.blur_max)
+    hw.blur_max = abs(hw.carriage - hw.exposure_carriage);
+#endif
+
+  if (hw.carriage - SWITCH1 < hw.margin_min)
+    hw.margin_min = hw.carriage - SWITCH1;
+  if (SWITCH2 - hw.carriage < hw.margin_min)
+    hw.margin_min = SWITCH2 - hw.carriage;
+  byte limiter = hw.carriage <= SWITCH1 || hw.carriage >= SWITCH2;
+  if (limiter != hw.limiter)
+  {
+    hw.limiter = limiter;
+    if (limiter)
+      PINB |= _BV(PINB0);
+    else
+      PINB &= ~_BV(PINB0);
+#ifdef LIMITER_INT
+    if ((PCICR & _BV(PCIE0)) && (PCMSK0 & _BV(PCINT0)))
+      PCINT0_vect();
+#endif
+  }
+}
+
+
+void rail_step()
+/* One pulse sent to the driver (with an occasional slip of the motor).
+ */
+{
+  COORD_TYPE d = 1;
+#ifdef MICROSTEP_SWITCH
+  if (hw.level[PIN_MS] == LOW)
+    d = N_MICROSTEPS;
+#endif
+  hw.pulses++;
+  hw.steps += d;
+  if (hw.level[PIN_ENABLE] == HIGH || hw.t - hw.t_enable < 1000UL * ENABLE_DELAY_MS)
+    hw.unready_pulses++;
+  if (hw.level[PIN_DIR] == LOW)
+    d = -d;
+  motor_step(d);
+  if (hw.slip_every && hw.pulses % hw.slip_every == 0)
+    motor_step(d > 0 ? -4 * N_MICROSTEPS : 4 * N_MICROSTEPS);
+  if (hw.accel_max > 0.0 && fabs(g.accel_v[2 + g.accel]) > 1.001 * hw.accel_max * ACCEL_LIMIT && ++hw.overdriven % 64 == 0)
+    motor_step(d > 0 ? -4 * N_MICROSTEPS : 4 * N_MICROSTEPS);
+}
+
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  byte old = hw.level[pin];
+  hw.level[pin] = val;
+  if (pin == PIN_STEP && old == LOW && val == HIGH)
+    rail_step();
+  if (pin == PIN_ENABLE && old == HIGH && val == LOW)
+    hw.t_enable = hw.t;
+  trace_sample();
+#ifdef AXIS2
+  if (pin == PIN_STEP2 && old == LOW && val == HIGH)
+  {
+    hw.pulses++;
+    hw.steps++;
+    if (hw.level[PIN_DIR2] == HIGH)
+      hw.y_motor++;
+    else
+      hw.y_motor--;
+    if (hw.y_carriage < hw.y_motor)
+      hw.y_carriage = hw.y_motor;
+    else if (hw.y_carriage > hw.y_motor + AXIS2_PLAY)
+      hw.y_carriage = hw.y_motor + AXIS2_PLAY;
+  }
+#endif
+  if (pin == PIN_SHUTTER && old == LOW && val == HIGH)
+  {
+    // The frame which is being shot was chosen in this loop (if g.pos_to_shoot already moved on to the next one), or earlier:
+    // (a physical coordinate: the rail coordinate plus the backlash taken up, when shooting while moving backwards)
+    COORD_TYPE target = (g.pos_to_shoot != hw.pos_to_shoot ? hw.pos_to_shoot : hw.shot_target) + g.BL_counter;
+    COORD_TYPE error = abs(hw.carriage - hw.offset - target);
+    if (hw.shots < (unsigned long)N_SHOT_LOG)
+      hw.shot_log[hw.shots] = hw.carriage - hw.offset;
+    // The firmware coordinates are mirrored on the reversed rail:
+    if (g.straight && error > hw.shot_error_max)
+      hw.shot_error_max = error;
+    hw.shots++;
+#ifdef STOP_AND_GO
+    hw.t_exposure = hw.t;
+    hw.exposure_carriage = hw.carriage;
+#endif
+#ifdef INPUT_SHAPER
+    if (fabs(hw.ring_y - hw.carriage) > hw.ring_max)
+      hw.ring_max = fabs(hw.ring_y - hw.carriage);
+#endif
+#ifdef CAMERA_BUFFER
+    // Camera buffer (written to the card at the sustained frame rate since the last shot):
+    camera_model cam;
+    memcpy(&cam, &CAMERAS[g.i_camera], sizeof(cam));
+    if (cam.buffer > 0)
+    {
+      hw.cam_buffer = max(0.0f, hw.cam_buffer - cam.sustained_fps * 1e-6f * (hw.t - hw.t_last_shot));
+      if (hw.cam_buffer + 1.0 > cam.buffer + 1e-3)
+        hw.missed_shots++;
+      else
+        hw.cam_buffer += 1.0;
+    }
+    hw.t_last_shot = hw.t;
+#endif
+#ifdef FLASH_SYNC
+    if (g.continuous_mode == 0 && g.noncont_flag == 3)
+    {
+      hw.exposures++;
+      if (hw.flash_miss == 0 || hw.exposures % hw.flash_miss != 0)
+      {
+        hw.flash = 1;
+        hw.t_flash = hw.t + FLASH_LATENCY_US + hw.jitter % (FLASH_LATENCY_US / 2);
+      }
+    }
+#endif
+#ifdef AXIS2
+    long y_error = labs(hw.y_carriage - (g.y_start + g.y_counter * AXIS2_DY));
+    if (y_error > hw.y_error_max)
+      hw.y_error_max = y_error;
+#endif
+  }
+}
+
+
+int digitalRead(uint8_t pin)
+{
+  trace_sample();
+  if (pin == PIN_LIMITERS)
+    return hw.limiter;
+
+  // Keypad matrix: a row reads LOW when a pressed key connects it to the column being pulled LOW:
+  for (byte r = 0; r < rows; r++)
+  {
+    if (rowPins[r] != pin)
+      continue;
+    for (byte c = 0; c < cols; c++)
+      if (hw.mode[colPins[c]] == OUTPUT && hw.level[colPins[c]] == LOW && hw.pressed[0] && (keys[r][c] == hw.pressed[0] || keys[r][c] == hw.pressed[1]))
+        return LOW;
+    return HIGH;
+  }
+
+  return hw.level[pin];
+}
+
+
+#ifdef FLASH_SYNC
+void flash_pin()
+/* The flash sync pin: LOW for one loop when the flash fires (the PCINT0 interrupt is called on both edges).
+ */
+{
+  if (hw.flash == 1 && hw.t >= hw.t_flash)
+  {
+    PINB &= ~_BV(PINB1);
+    hw.flash = 2;
+  }
+  else if (hw.flash == 2)
+  {
+    PINB |= _BV(PINB1);
+    hw.flash = 0;
+  }
+  else
+    return;
+  if ((PCICR & _BV(PCIE0)) && (PCMSK0 & _BV(PCINT1)))
+    PCINT0_vect();
+}
+#endif
+
+
+//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Running the sketch:
+
+unsigned long host_ns()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return 1000000000UL * ts.tv_sec + ts.tv_nsec;
+}
+
+
+#ifdef INPUT_SHAPER
+void ring()
+/* Integrating the camera motion up to now (in substeps of at most 50 us; the carriage is assumed to move at a constant speed since t_ring).
+ */
+{
+  if (hw.t == hw.t_ring)
+    return;
+  const float w = 2.0 * PI * RING_HZ * 1e-6;
+  float dt = hw.t - hw.t_ring;
+  int n = (int)ceil(dt / 50.0);
+  float h = dt / n;
+  float vc = (hw.carriage - hw.ring_carriage) / dt;
+  for (int i = 1; i <= n; i++)
+  {
+    float c = hw.ring_carriage + vc * h * i;
+    hw.ring_v += h * (-w * w * (hw.ring_y - c) - 2.0 * RING_ZETA * w * (hw.ring_v - vc));
+    hw.ring_y += h * hw.ring_v;
+  }
+  hw.ring_carriage = hw.carriage;
+  hw.t_ring = hw.t;
+}
+#endif
+
+
+void bench_loop()
+/* One loop() call, with all the bookkeeping.
+ */
+{
+  // xorshift, for the +-20% jitter of the loop duration:
+  hw.jitter ^= hw.jitter << 13;
+  hw.jitter ^= hw.jitter >> 7;
+  hw.jitter ^= hw.jitter << 17;
+  hw.t += LOOP_US - LOOP_US / 5 + hw.jitter % (2 * LOOP_US / 5 + 1);
+#ifdef FLASH_SYNC
+  flash_pin();
+#endif
+#ifdef INPUT_SHAPER
+  ring();
+#endif
+
+  COORD_TYPE pos_short_old = g.pos_short_old;
+  unsigned long pulses = hw.pulses;
+  hw.pos_to_shoot = g.pos_to_shoot;
+  byte moving = g.moving;
+  unsigned long t_loop = hw.t;
+
+  unsigned long t0 = host_ns();
+  loop();
+  unsigned long dt = host_ns() - t0;
+
+  hw.hist[min(dt, HIST_MAX_NS) / HIST_BIN_NS]++;
+  hw.loops++;
+  if (dt > hw.loop_ns_max)
+    hw.loop_ns_max = dt;
+  if (g.pos_to_shoot != hw.pos_to_shoot)
+    hw.shot_target = hw.pos_to_shoot;
+  // Stop-to-restart latency:
+  if (hw.restart == 1)
+    hw.restart = g.started_moving || g.moving ? 2 : 0;
+  if (hw.restart == 2 && g.moving)
+  {
+    hw.restart = 0;
+    hw.restarts++;
+    if (hw.t - hw.t_stop > hw.restart_max)
+      hw.restart_max = hw.t - hw.t_stop;
+  }
+  else if (hw.restart == 2 && g.started_moving == 0)
+    hw.restart = 0;
+  if (moving && g.moving == 0)
+  {
+    hw.restart = 1;
+    hw.t_stop = t_loop;
+  }
+  // One step was made, but the new position is more than one microstep away (full steps are always N_MICROSTEPS away, and
+  // the catch-up microsteps after full steps are made in one go):
+  if (hw.pulses == pulses + 1 && abs(floorMy(g.pos) - pos_short_old) > 1
+#ifdef MICROSTEP_SWITCH
+      && !g.ms_coarse
+#endif
+     )
+    hw.skipped_steps++;
+}
+
+
+void run(float seconds)
+/* Running the sketch for some time (virtual seconds).
+ */
+{
+  unsigned long t_end = hw.t + (unsigned long)(seconds * 1e6);
+  while (hw.t < t_end)
+    bench_loop();
+}
+
+
+byte at_rest()
+{
+  return g.moving == 0 && g.started_moving == 0 && g.backlashing == 0 && g.breaking == 0;
+}
+
+
+byte stacking_done()
+{
+#ifdef AXIS2
+  if (g.y_moving)
+    return 0;
+#endif
+  return at_rest() && g.stacker_mode == 0 && g.end_of_stacking == 0 && g.timelapse_mode == 0;
+}
+
+
+#ifdef ENCODER
+byte encoder_done()
+{
+  return stacking_done() && g.enc_flag == 0;
+}
+#endif
+
+
+#ifdef JOB_QUEUE
+byte job_waiting()
+{
+  return at_rest() && g.job_i == 1 && g.stacker_mode == 4;
+}
+
+
+byte queue_done()
+{
+  return stacking_done() && g.job_mode == 0 && g.job_i == g.job_n;
+}
+#endif
+
+
+byte move_done()
+{
+  return at_rest() && g.BL_counter == 0;
+}
+
+
+byte calibration_done()
+{
+#ifdef HOMING
+  if (g.homing_flag)
+    return 0;
+#endif
+  return at_rest() && g.calibrate == 0 && g.calibrate_warning == 0;
+}
+
+
+byte startup_done()
+// The rail is ready after a power-up: no backlash loop, calibration or quick verify pending
+{
+#ifdef FAST_STARTUP
+  if (g.boot_flag)
+    return 0;
+#endif
+  return calibration_done() && g.backlash_init == 0 && g.BL_counter == 0;
+}
+
+
+byte run_until(byte (*done)(), float timeout)
+/* Running the sketch until done() returns 1 (checked after each loop), or the timeout (virtual seconds) expires.
+   Returns 1 if done.
+ */
+{
+  unsigned long t_end = hw.t + (unsigned long)(timeout * 1e6);
+  byte ok = 0;
+  hw.done = done;
+  while (hw.t < t_end && ok == 0)
+  {
+    bench_loop();
+    ok = done();
+  }
+  hw.done = 0;
+  return ok;
+}
+
+
+void press(char key1, char key2)
+/* Pressing one key (key2=0), or a two-key combination (key1 is pressed first, and held), and releasing it.
+   The keypad is scanned every 50 ms, so the keys are held long enough to be seen by the sketch.
+ */
+{
+  hw.pressed[0] = key1;
+  hw.pressed[1] = 0;
+  run(0.2);
+  if (key2)
+  {
+    hw.pressed[1] = key2;
+    run(0.2);
+  }
+  hw.pressed[0] = 0;
+  hw.pressed[1] = 0;
+}
+
+
+void power_up(byte calibrated)
+/* A fresh start with an empty EEPROM (factory reset). If calibrated=1, the limits are set as if the rail has already
+   been calibrated (the way MOTOR_DEBUG does it), for all the stacking scenarios.
+ */
+{
+  memset(&hw, 0, sizeof(hw));
+  hw.jitter = 2463534242UL;
+  hw.margin_min = (COORD_TYPE)RAIL_MICROSTEPS;
+  memset(EEPROM.mem, 255, sizeof(EEPROM.mem));
+  memset((void *)&g, 0, sizeof(g));
+  // The flash sync pin has a pullup:
+  PINB = _BV(PINB1);
+  keypad = Keypad(makeKeymap(keys), rowPins, colPins, rows, cols);
+  // Factory reset puts the rail half way between the default point1 and point2:
+  hw.motor = 2500;
+  hw.carriage = hw.motor;
+#ifdef ENCODER
+  PINB = 0;
+  encoder_pins();
+#endif
+  setup();
+  hw.offset = hw.motor - g.pos_short_old;
+  if (ACCEL_I >= 0)
+  {
+    g.i_accel_factor = ACCEL_I;
+    set_accel_v();
+  }
+#ifdef INPUT_SHAPER
+  // The camera is at rest:
+  hw.ring_y = hw.carriage;
+  hw.ring_carriage = hw.carriage;
+  hw.t_ring = hw.t;
+#endif
+
+  if (calibrated)
+  {
+    g.calibrate = 0;
+    g.calibrate_warning = 0;
+    g.calibrate_init = g.calibrate;
+    g.limit1 = SWITCH1 + LIMITER_PAD - hw.offset;
+    g.limit2 = SWITCH2 - LIMITER_PAD - hw.offset;
+    display_all();
+  }
+  run(1.0);
+}
+
+
+#ifdef JOB_QUEUE
+void power_cycle()
+/* Switching the power off and on, with the rail at rest: the EEPROM and the rail position are kept, and the limits are set again the way
+   power_up() does it.
+ */
+{
+  COORD_TYPE limit1 = g.limit1;
+  COORD_TYPE limit2 = g.limit2;
+  // As if the limits were found by calibration (so the boot record of FAST_STARTUP agrees with them):
+  EEPROM.put( ADDR_LIMIT1, g.limit1);
+  EEPROM.put( ADDR_LIMIT2, g.limit2);
+  EEPROM.put( ADDR_CALIBRATE, g.calibrate);
+  memset((void *)&g, 0, sizeof(g));
+  keypad = Keypad(makeKeymap(keys), rowPins, colPins, rows, cols);
+  setup();
+  g.calibrate = 0;
+  g.calibrate_warning = 0;
+  g.calibrate_init = g.calibrate;
+  g.limit1 = limit1;
+  g.limit2 = limit2;
+  display_all();
+  run(1.0);
+}
+#endif
+
+
+void save_limits()
+/* The limits where a full calibration would put them (when approaching switch 1, the carriage is RAIL_PLAY ahead of the motor), saved in EEPROM
+   together with the end of the calibration, so the rail is calibrated after a power cycle as well.
+ */
+{
+  g.limit1 = SWITCH1 - RAIL_PLAY + LIMITER_PAD - hw.offset;
+  EEPROM.put( ADDR_LIMIT1, g.limit1);
+  EEPROM.put( ADDR_LIMIT2, g.limit2);
+  EEPROM.put( ADDR_CALIBRATE, g.calibrate);
+}
+
+
+void reboot()
+/* Switching the power off and on, right now (the rail stops wherever it is): the EEPROM and the motor and carriage positions are kept.
+ */
+{
+  memset((void *)&g, 0, sizeof(g));
+  memset(hw.level, 0, sizeof(hw.level));
+  keypad = Keypad(makeKeymap(keys), rowPins, colPins, rows, cols);
+  setup();
+}
+
+
+void set_params(byte i_mm_per_frame, byte i_fps, byte i_n_shots, COORD_TYPE point1, COORD_TYPE point2)
+/* Setting the stacking parameters (indexes in the tables), as if done with the keypad.
+ */
+{
+  g.i_mm_per_frame = i_mm_per_frame;
+  g.i_fps = i_fps;
+  g.i_n_shots = i_n_shots;
+  g.point1 = point1;
+  g.point2 = point2;
+  g.msteps_per_frame = Msteps_per_frame();
+  g.Nframes = Nframes();
+  display_all();
+}
+
+
+void report(const char *name, byte ok, unsigned long t0, unsigned long host_t0, short stacks, COORD_TYPE pos_error)
+{
+  float t = (hw.t - t0) * 1e-6;
+  unsigned long q[4] = {0};
+  const float P[4] = {0.5, 0.9, 0.99, 0.999};
+  unsigned long n = 0;
+  byte k = 0;
+  for (unsigned long i = 0; i <= HIST_MAX_NS / HIST_BIN_NS; i++)
+  {
+    n += hw.hist[i];
+    while (k < 4 && n >= P[k] * hw.loops)
+      q[k++] = i * HIST_BIN_NS;
+  }
+  printf("{\"scenario\": \"%s\", \"ok\": %s, \"stacks\": %d, \"t_stack_s\": %.3f, \"host_s\": %.3f, \"loops\": %lu, \"steps\": %lu, "
+         "\"steps_per_s\": %.1f, \"pulses\": %lu, \"shots\": %lu, \"missed_shots\": %lu, \"shot_error_max\": %ld, \"pos_error\": %ld, \"awake_pct\": %.2f, \"skipped_steps\": %lu, \"limiter_margin\": %ld, "
+         "\"restarts\": %lu, \"restart_us_max\": %lu, \"unready_pulses\": %lu, "
+         "\"loop_ns_p50\": %lu, \"loop_ns_p90\": %lu, \"loop_ns_p99\": %lu, \"loop_ns_p999\": %lu, \"loop_ns_max\": %lu}\n",
+         name, ok ? "true" : "false", stacks, t / stacks, (host_ns() - host_t0) * 1e-9, hw.loops, hw.steps,
+         hw.steps / t, hw.pulses, hw.shots, hw.missed_shots, (long)hw.shot_error_max, (long)pos_error, 100.0 - 1e-4 * hw.t_sleep / t, hw.skipped_steps, (long)hw.margin_min,
+         hw.restarts, hw.restart_max, hw.unready_pulses,
+         q[0], q[1], q[2], q[3], hw.loop_ns_max);
+  fflush(stdout);
+}
+
+
+void start_counters(unsigned long *t0, unsigned long *host_t0)
+{
+  hw.pulses = 0;
+  hw.steps = 0;
+  hw.shots = 0;
+  hw.shot_error_max = 0;
+  hw.cam_buffer = 0.0;
+  hw.missed_shots = 0;
+  hw.skipped_steps = 0;
+  hw.restarts = 0;
+  hw.restart_max = 0;
+  hw.unready_pulses = 0;
+  hw.loops = 0;
+  hw.t_sleep = 0;
+  hw.loop_ns_max = 0;
+#ifdef AXIS2
+  hw.y_error_max = 0;
+#endif
+#ifdef STOP_AND_GO
+  hw.t_exposure = hw.t - STOP_AND_GO_EXPOSURE_US;
+  hw.blur_max = 0;
+#endif
+#ifdef INPUT_SHAPER
+  hw.ring_max = 0.0;
+#endif
+  memset(hw.hist, 0, sizeof(hw.hist));
+  *t0 = hw.t;
+  *host_t0 = host_ns();
+}
+
+
+COORD_TYPE final_error()
+// Carriage position error once the rail stopped (in firmware coordinates):
+{
+  return hw.carriage - hw.offset - g.pos_short_old;
+}
+
+
+//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Scenarios:
+
+void one_point()
+// "D": 1-point stack of 600 shots, 0.01 mm per frame, 4 fps
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  set_params(3, 24, 24, 2000, 3000);
+  start_counters(&t0, &host_t0);
+  press('D', 0);
+  byte ok = run_until(stacking_done, 1000.0);
+  report("1point_600", ok && hw.shots == 600, t0, host_t0, 1, final_error());
+}
+
+
+void two_point()
+// "0": 2-point continuous stack, 10 mm at 0.05 mm per frame, 4 fps (point1 is behind the rail, so backlash compensation is included)
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  COORD_TYPE point1 = 1000;
+  set_params(9, 24, 0, point1, point1 + (COORD_TYPE)(10.0 / MM_PER_MICROSTEP));
+  start_counters(&t0, &host_t0);
+  press('0', 0);
+  byte ok = run_until(stacking_done, 1000.0);
+  report("2point_cont_4fps", ok && hw.shots == (unsigned long)g.Nframes, t0, host_t0, 1, final_error());
+}
+
+
+#ifdef CAMERA_BUFFER
+void burst_buffer()
+// "0" with camera model 2 (16 frames buffer, 4 fps burst, 1 fps sustained): 2-point continuous stack of 100 frames, 0.05 mm per frame, 4 fps
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  g.i_camera = 2;
+  COORD_TYPE point1 = 1000;
+  set_params(9, 24, 0, point1, point1);
+  set_params(9, 24, 0, point1, point1 + (COORD_TYPE)ceil(99 * g.msteps_per_frame));
+  start_counters(&t0, &host_t0);
+  press('0', 0);
+  byte ok = run_until(stacking_done, 1000.0);
+  report("2point_burst_buffer", ok && g.Nframes == 100 && hw.shots == 100 && hw.missed_shots == 0, t0, host_t0, 1, final_error());
+}
+#endif
+
+
+#ifdef STOP_AND_GO
+void two_point_sng()
+// "0": 2-point stop-and-go continuous stack of 50 frames, 0.1 mm per frame, 1 fps (the continuous speed would be 0.1 mm/s)
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  COORD_TYPE point1 = 1000;
+  set_params(12, 17, 0, point1, point1);
+  set_params(12, 17, 0, point1, point1 + (COORD_TYPE)ceil(49 * g.msteps_per_frame));
+  start_counters(&t0, &host_t0);
+  press('0', 0);
+  byte ok = run_until(stacking_done, 1000.0);
+  // The rail travel during an exposure can't be smaller than one microstep:
+  COORD_TYPE blur = (COORD_TYPE)ceil(1e-3 * STOP_AND_GO_BLUR_UM / MM_PER_MICROSTEP);
+  report("2point_stop_and_go", ok && g.Nframes == 50 && hw.shots == 50 && hw.missed_shots == 0 && hw.blur_max <= blur, t0, host_t0, 1, hw.blur_max);
+}
+#endif
+
+
+void non_continuous()
+// "#0": 100-frame non-continuous 2-point stack with mirror lock, 0.05 mm per frame, both delays 0.5 s
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  g.mirror_lock = 1;
+  g.i_first_delay = 0;
+  g.i_second_delay = 0;
+  COORD_TYPE point1 = 1000;
+  set_params(9, 24, 0, point1, point1);
+  set_params(9, 24, 0, point1, point1 + (COORD_TYPE)ceil(99 * g.msteps_per_frame));
+  start_counters(&t0, &host_t0);
+  press('#', '0');
+  byte ok = run_until(stacking_done, 1000.0);
+  report("noncont_100_mirror_lock", ok && g.Nframes == 100 && hw.shots == 200, t0, host_t0, 1, final_error());
+}
+
+
+void non_continuous_settle()
+// "#0": 100-frame non-continuous 2-point stack without mirror lock, 0.01 mm per frame, delays 2 s (a conservative FIRST_DELAY) and 0.5 s
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  g.mirror_lock = 0;
+  g.i_first_delay = 3;
+  g.i_second_delay = 0;
+  COORD_TYPE point1 = 1000;
+  set_params(3, 24, 0, point1, point1);
+  set_params(3, 24, 0, point1, point1 + (COORD_TYPE)ceil(99 * g.msteps_per_frame));
+  start_counters(&t0, &host_t0);
+  press('#', '0');
+  byte ok = run_until(stacking_done, 1000.0);
+  report("noncont_100_settle", ok && g.Nframes == 100 && hw.shots == 100, t0, host_t0, 1, final_error());
+}
+
+
+void step_loss()
+// "0" with a motor slip every 1000 pulses: 2-point continuous stack, 10 mm at 0.05 mm per frame, 4 fps (as in 2point_cont_4fps). Without
+// ENCODER the lost steps show up as the final position error; with it they are corrected
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  hw.slip_every = 1000;
+  COORD_TYPE point1 = 1000;
+  set_params(9, 24, 0, point1, point1 + (COORD_TYPE)(10.0 / MM_PER_MICROSTEP));
+  start_counters(&t0, &host_t0);
+  press('0', 0);
+#ifdef ENCODER
+  // Including the verification of the final position (and the correction move, if any):
+  byte ok = run_until(encoder_done, 1000.0) && hw.shots == (unsigned long)g.Nframes && abs(final_error()) <= ENCODER_TOLERANCE;
+#else
+  byte ok = run_until(stacking_done, 1000.0) && hw.shots == (unsigned long)g.Nframes;
+#endif
+  report("2point_step_loss", ok, t0, host_t0, 1, final_error());
+}
+
+
+#ifdef FLASH_SYNC
+void flash_sync_stack()
+// "#0" with FLASH_SYNC: 100-frame non-continuous 2-point stack with mirror lock, 0.05 mm per frame, delays 0.5 s and 3 s (the timeout),
+// every 25th exposure missed by the camera (and retried)
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  g.mirror_lock = 1;
+  g.i_first_delay = 0;
+  g.i_second_delay = 4;
+  hw.flash_miss = 25;
+  COORD_TYPE point1 = 1000;
+  set_params(9, 24, 0, point1, point1);
+  set_params(9, 24, 0, point1, point1 + (COORD_TYPE)ceil(99 * g.msteps_per_frame));
+  start_counters(&t0, &host_t0);
+  press('#', '0');
+  byte ok = run_until(stacking_done, 1000.0);
+  // 100 mirror lock-ups, and 100 + 4 retried exposures:
+  report("noncont_100_flash_sync", ok && g.Nframes == 100 && hw.shots == 204 && strncmp(g.buffer, "L", 1) == 0, t0, host_t0, 1, final_error());
+}
+#endif
+
+
+void timelapse()
+// "0" with N_timelapse=999, dt_timelapse=1 s: 999 short 2-point continuous stacks (5 frames each)
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  g.i_n_timelapse = N_N_TIMELAPSE - 1;
+  g.i_dt_timelapse = 0;
+  COORD_TYPE point1 = 1000;
+  set_params(9, 24, 0, point1, point1);
+  set_params(9, 24, 0, point1, point1 + (COORD_TYPE)ceil(4 * g.msteps_per_frame));
+  start_counters(&t0, &host_t0);
+  press('0', 0);
+  byte ok = run_until(stacking_done, 100000.0);
+  report("timelapse_999", ok && hw.shots == 999UL * g.Nframes, t0, host_t0, n_timelapse(), final_error());
+}
+
+
+void timelapse_idle()
+// "0" with N_timelapse=10, dt_timelapse=30 s: short 2-point continuous stacks (5 frames each), the rail is at rest most of the time
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  g.i_n_timelapse = 2;
+  g.i_dt_timelapse = 3;
+  COORD_TYPE point1 = 1000;
+  set_params(9, 24, 0, point1, point1);
+  set_params(9, 24, 0, point1, point1 + (COORD_TYPE)ceil(4 * g.msteps_per_frame));
+  start_counters(&t0, &host_t0);
+  press('0', 0);
+  byte ok = run_until(stacking_done, 1000.0);
+  report("timelapse_10_idle", ok && hw.shots == 10UL * g.Nframes, t0, host_t0, n_timelapse(), final_error());
+}
+
+
+void full_calibration()
+// "#C", then any key: full calibration of both limiters, from the factory reset state
+{
+  unsigned long t0, host_t0;
+  power_up(0);
+  start_counters(&t0, &host_t0);
+  // After the factory reset the calibration warning is already displayed; "#C" just asks again:
+  press('#', 'C');
+  press('D', 0);
+  byte ok = run_until(calibration_done, 1000.0);
+  // The calibration moved the origin of the firmware coordinates:
+  hw.offset = hw.motor - g.pos_short_old;
+  // Motor positions where the switches go on: when approaching switch 1 (negative direction) the carriage is RAIL_PLAY ahead of the motor:
+  COORD_TYPE error1 = g.limit1 - LIMITER_PAD + hw.offset - (SWITCH1 - RAIL_PLAY);
+  COORD_TYPE error2 = g.limit2 + LIMITER_PAD + hw.offset - SWITCH2;
+  report("full_calibration", ok, t0, host_t0, 1, max(abs(error1), abs(error2)));
+}
+
+
+void startup_at_rest()
+// Power cycle with the rail at rest (after a move in the bad direction, with the backlash compensated), until the rail is ready again
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  save_limits();
+  go_to(1500.5, g.speed_limit);
+  run_until(startup_done, 100.0);
+  run(1.0);
+  start_counters(&t0, &host_t0);
+  reboot();
+  byte ok = run_until(startup_done, 1000.0);
+  report("startup_at_rest", ok && g.pos_short_old == 1500, t0, host_t0, 1, final_error());
+}
+
+
+void startup_power_loss()
+// Power cycle while the rail is moving (0.5 s into a 10 mm move), until the rail is ready again; the final position error is the error of the
+// position the rail starts with
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  save_limits();
+  go_to(1500.5, g.speed_limit);
+  run_until(startup_done, 100.0);
+  run(1.0);
+  go_to(1500.5 + 10.0 / MM_PER_MICROSTEP, g.speed_limit);
+  run(0.5);
+  start_counters(&t0, &host_t0);
+  reboot();
+  byte ok = run_until(startup_done, 1000.0);
+#ifdef FAST_STARTUP
+  // The quick verify finds the position again:
+  ok = ok && final_error() == 0;
+#endif
+  report("startup_power_loss", ok, t0, host_t0, 1, final_error());
+}
+
+
+COORD_TYPE move_to(COORD_TYPE pos)
+/* A go_to() move to pos, at the speed limit, until the rail is at rest with the backlash compensated. Returns the overshoot: how far
+   the motor went beyond the target (moving backwards, the target is g.backlash further, where the backlash compensation starts).
+ */
+{
+  COORD_TYPE target = pos + hw.offset;
+  char dir = pos > g.pos_short_old ? 1 : -1;
+  if (dir < 0)
+    target = target - g.backlash;
+  COORD_TYPE overshoot = 0;
+  go_to((float)pos + 0.5, g.speed_limit);
+  unsigned long t_end = hw.t + 100000000UL;
+  hw.done = move_done;
+  do
+  {
+    bench_loop();
+    if (dir * (hw.motor - target) > overshoot)
+      overshoot = dir * (hw.motor - target);
+  }
+  while (!move_done() && hw.t < t_end);
+  hw.done = 0;
+  return overshoot;
+}
+
+
+void hold(char key, COORD_TYPE d)
+/* Holding a key (rewind or fast-forward) until the rail travelled d microsteps (d=0: until it stopped by itself, at a soft limit), then
+   releasing it, until the rail is at rest with the backlash compensated.
+ */
+{
+  COORD_TYPE pos0 = g.pos_short_old;
+  unsigned long t_end = hw.t + 1000000000UL;
+  hw.pressed[0] = key;
+  run(0.2);
+  while ((d > 0 ? abs(g.pos_short_old - pos0) < d : !at_rest()) && hw.t < t_end)
+    bench_loop();
+  hw.pressed[0] = 0;
+  run_until(move_done, 100.0);
+}
+
+
+void moves(const char *name, char i_accel_tune)
+/* A cycle of go_to() moves (0.1, 1 and 10 mm, forward and back), and 10 mm of fast-forward ("A" held) and of rewind ("1" held). Before it,
+   the rail is fast-forwarded and rewound into both soft limits (not included in the cycle time). With ACCEL_TUNE, the acceleration is
+   TUNED_ACCEL[i_accel_tune] (-1: the factory default).
+ */
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+#ifdef ACCEL_TUNE
+  if (i_accel_tune >= 0)
+  {
+    g.i_accel_tune = i_accel_tune;
+    set_accel_v();
+  }
+#else
+  (void)i_accel_tune;
+#endif
+  COORD_TYPE middle = (g.limit1 + g.limit2) / 2;
+  const float D_MM[3] = {0.1, 1.0, 10.0};
+  hold('A', 0);
+  hold('1', 0);
+  byte ok = g.error == 0 && g.calibrate == 0;
+  move_to(middle);
+  start_counters(&t0, &host_t0);
+  COORD_TYPE overshoot = 0;
+  for (byte i = 0; i < 3; i++)
+  {
+    COORD_TYPE d = (COORD_TYPE)(D_MM[i] / MM_PER_MICROSTEP);
+    overshoot = max(overshoot, move_to(middle + d));
+    overshoot = max(overshoot, move_to(middle));
+  }
+  hold('A', (COORD_TYPE)(10.0 / MM_PER_MICROSTEP));
+  hold('1', (COORD_TYPE)(10.0 / MM_PER_MICROSTEP));
+  overshoot = max(overshoot, move_to(middle));
+  ok = ok && g.error == 0 && g.pos_short_old == middle && final_error() == 0 && hw.margin_min > 0;
+  report(name, ok, t0, host_t0, 1, overshoot);
+}
+
+
+void moves_cycle()
+{
+  moves("moves_cycle", -1);
+}
+
+
+#ifdef ACCEL_TUNE
+void moves_cycle_tuned()
+// The same, at twice ACCEL_LIMIT (as tuned for the light payload of accel_tune_light)
+{
+  moves("moves_cycle_tuned", 4);
+}
+
+
+byte tune_started()
+// The full calibration before the tuning is over (the first tuning move was just requested)
+{
+  return g.tune_flag != 7;
+}
+
+
+byte tune_done()
+{
+  return at_rest() && g.tune_flag == 0 && g.homing_flag == 0;
+}
+
+
+void tuning(const char *name, float accel_max, byte i_expected)
+/* "#C", then "A": full calibration and acceleration tuning, for a payload which slips above accel_max times ACCEL_LIMIT. The tuned acceleration
+   should be the largest one of the TUNED_ACCEL table not above accel_max (index i_expected), and the lost steps of the first failed test should
+   be corrected.
+ */
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  hw.accel_max = accel_max;
+  start_counters(&t0, &host_t0);
+  press('#', 'C');
+  press('A', 0);
+  byte ok = run_until(tune_started, 1000.0) && g.tune_flag == 2;
+  // The calibration moved the origin of the firmware coordinates (the rail hasn't moved yet since it stopped):
+  hw.offset = hw.carriage - g.pos_short_old;
+  ok = ok && run_until(tune_done, 3000.0);
+  COORD_TYPE error = final_error();
+  ok = ok && g.i_accel_tune == i_expected && g.calibrate == 0 && g.error == 0 && abs(error) <= ACCEL_TUNE_TOL;
+  // The tuned acceleration survives a power cycle:
+  reboot();
+  ok = ok && g.i_accel_tune == i_expected;
+  report(name, ok, t0, host_t0, 1, error);
+}
+
+
+void accel_tune_light()
+{
+  tuning("accel_tune_light", 2.5, 4);
+}
+
+
+void accel_tune_heavy()
+{
+  tuning("accel_tune_heavy", 0.8, 1);
+}
+#endif
+
+
+#ifdef AXIS2
+void job()
+// "0" with 4 lateral positions (*# three times): 2-point continuous stacks of 20 frames, 0.05 mm per frame, at each position
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  for (byte i = 0; i < 3; i++)
+    press('*', '#');
+  COORD_TYPE point1 = 1000;
+  set_params(9, 24, 0, point1, point1);
+  set_params(9, 24, 0, point1, point1 + (COORD_TYPE)ceil(19 * g.msteps_per_frame));
+  start_counters(&t0, &host_t0);
+  press('0', 0);
+  byte ok = run_until(stacking_done, 1000.0);
+  // The lateral axis should be back at the first position:
+  ok = ok && n_y() == 4 && hw.shots == 4UL * g.Nframes && g.y_short_old == 0 && hw.y_carriage == 0;
+  report("axis2_job_4x", ok, t0, host_t0, n_y(), hw.y_error_max);
+}
+#endif
+
+
+#ifdef JOB_QUEUE
+void job_queue()
+// "*#", three jobs ("#3" "0", "#6" "#0", "#3" "0"), "*#": bank 1 is a 20-frame continuous stack, 0.05 mm per frame; bank 2 is a timelapse of three
+// 10-frame non-continuous stacks, 30 s apart, on the reversed rail (so each job starts with a rail reversal). The power is cycled after the first
+// stack of the second job, and "*#" resumes the queue
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  g.i_dt_timelapse = 0;
+  g.i_first_delay = 0;
+  g.i_second_delay = 0;
+  g.mirror_lock = 0;
+  COORD_TYPE point1 = 1000;
+  set_params(9, 24, 0, point1, point1);
+  set_params(9, 24, 0, point1, point1 + (COORD_TYPE)ceil(19 * g.msteps_per_frame));
+  // The keys are released for a while between the commands (the keypad has to see them released), and the rail reversals have time to finish:
+  const char commands[][2] = {{'#', '2'}, {'*', '1'}, {0, 0}, {'#', '5'}, {'*', '#'}, {'#', '3'}, {'0', 0}, {'#', '6'}, {'#', '0'}, {'#', '3'}, {'0', 0}};
+  for (byte i = 0; i < sizeof(commands) / sizeof(commands[0]); i++)
+  {
+    if (commands[i][0])
+      press(commands[i][0], commands[i][1]);
+    else
+    {
+      // Bank 2:
+      g.i_n_timelapse = 1;
+      g.i_dt_timelapse = 3;
+      point1 = g.point1;
+      set_params(9, 24, 0, point1, point1 + (COORD_TYPE)ceil(9 * g.msteps_per_frame));
+    }
+    run(5.0);
+  }
+  start_counters(&t0, &host_t0);
+  press('*', '#');
+  byte ok = g.job_n == 3 && run_until(job_waiting, 1000.0);
+  power_cycle();
+  // The full backlash loop after powering up:
+  run(5.0);
+  press('*', '#');
+  ok = ok && run_until(queue_done, 1000.0);
+  report("job_queue_3", ok && hw.shots == 2 * 20 + 3 * 10, t0, host_t0, 5, final_error());
+}
+#endif
+
+
+#ifdef INPUT_SHAPER
+void ringing(const char *name, byte i_shaper)
+// "#0" with the shaper model i_shaper: 20-frame non-continuous 2-point stack without mirror lock, 0.1 mm per frame, the shortest delays
+// (point1 is ahead of the rail, so there is no backlash compensation: taking up the play kicks the camera, and no shaping can help that)
+{
+  unsigned long t0, host_t0;
+  power_up(1);
+  g.i_shaper = i_shaper;
+  shaper_init();
+  g.mirror_lock = 0;
+  g.i_first_delay = 0;
+  g.i_second_delay = 0;
+  COORD_TYPE point1 = 3000;
+  set_params(12, 24, 0, point1, point1);
+  set_params(12, 24, 0, point1, point1 + (COORD_TYPE)ceil(19 * g.msteps_per_frame));
+  start_counters(&t0, &host_t0);
+  press('#', '0');
+  byte ok = run_until(stacking_done, 1000.0);
+  // With shaping, the camera should be within 0.1 microstep of the carriage (the microsteps themselves, slow ones at the end of a shaped move
+  // especially, excite about that much):
+  report(name, ok && g.Nframes == 20 && hw.shots == 20 && final_error() == 0 && (i_shaper == 0 || hw.ring_max < 0.1), t0, host_t0, 1,
+         (COORD_TYPE)(hw.ring_max * MM_PER_MICROSTEP * 1e6 + 0.5));
+}
+
+void ringing_none()
+{
+  ringing("noncont_20_ringing", 0);
+}
+
+void ringing_zv()
+{
+  ringing("noncont_20_ringing_zv", 1);
+}
+
+void ringing_zvd()
+{
+  ringing("noncont_20_ringing_zvd", 2);
+}
+#endif
+
+
+byte same_frames(short stacks, short n, byte serpentine)
+/* 1 if every stack of a timelapse sequence (n shots each, in the shot log) was shot at the same carriage positions as the first one (in the reverse
+   order for the odd ones, if serpentine=1).
+ */
+{
+  if (stacks * n > N_SHOT_LOG)
+    return 0;
+  for (short k = 1; k < stacks; k++)
+    for (short i = 0; i < n; i++)
+    {
+      short j = serpentine && (k & 1) ? n - 1 - i : i;
+      if (hw.shot_log[k * n + i] != hw.shot_log[j])
+        return 0;
+    }
+  return 1;
+}
+
+
+void timelapse_2mm(const char *name, byte continuous)
+/* "0" (continuous) or "#0" (non-continuous, without mirror lock, delays 0.5 s) with N_timelapse=10, dt_timelapse=1 s: 2-point stacks of 20 frames,
+   0.1 mm per frame. The backlash of the firmware is the real one (as if measured), so all the stacks should have the same frames, even the
+   backward ones (SERPENTINE, continuous stacks only).
+ */
+{
+  unsigned long t0, host_t0;
+  byte serpentine = 0;
+#ifdef SERPENTINE
+  serpentine = continuous;
+#endif
+  power_up(1);
+#ifdef BL_MAP
+  for (byte i = 0; i < N_BL_MAP; i++)
+    g.bl_map[i] = RAIL_PLAY;
+#endif
+  g.backlash = RAIL_PLAY;
+  g.i_n_timelapse = 2;
+  g.i_dt_timelapse = 0;
+  g.mirror_lock = 0;
+  g.i_first_delay = 0;
+  g.i_second_delay = 0;
+  COORD_TYPE point1 = 1000;
+  set_params(12, 24, 0, point1, point1);
+  set_params(12, 24, 0, point1, point1 + (COORD_TYPE)ceil(19 * g.msteps_per_frame));
+  start_counters(&t0, &host_t0);
+  if (continuous)
+    press('0', 0);
+  else
+    press('#', '0');
+  byte ok = run_until(stacking_done, 1000.0);
+  report(name, ok && g.Nframes == 20 && hw.shots == 10UL * g.Nframes && hw.shot_error_max == 0 && same_frames(10, g.Nframes, serpentine), t0, host_t0,
+         n_timelapse(), final_error());
+}
+
+
+void timelapse_2mm_cont()
+{
+  timelapse_2mm("timelapse_10_2mm", 1);
+}
+
+
+void timelapse_2mm_noncont()
+{
+  timelapse_2mm("timelapse_10_2mm_noncont", 0);
+}
+
+
+struct scenario
+{
+  const char *name;
+  void (*run)();
+};
+
+const scenario SCENARIOS[] = {
+  {"1point_600", one_point},
+  {"2point_cont_4fps", two_point},
+  {"2point_step_loss", step_loss},
+#ifdef CAMERA_BUFFER
+  {"2point_burst_buffer", burst_buffer},
+#endif
+#ifdef STOP_AND_GO
+  {"2point_stop_and_go", two_point_sng},
+#endif
+  {"noncont_100_mirror_lock", non_continuous},
+  {"noncont_100_settle", non_continuous_settle},
+#ifdef FLASH_SYNC
+  {"noncont_100_flash_sync", flash_sync_stack},
+#endif
+#ifdef INPUT_SHAPER
+  {"noncont_20_ringing", ringing_none},
+  {"noncont_20_ringing_zv", ringing_zv},
+  {"noncont_20_ringing_zvd", ringing_zvd},
+#endif
+  {"timelapse_999", timelapse},
+  {"timelapse_10_idle", timelapse_idle},
+  {"timelapse_10_2mm", timelapse_2mm_cont},
+  {"timelapse_10_2mm_noncont", timelapse_2mm_noncont},
+  {"full_calibration", full_calibration},
+  {"startup_at_rest", startup_at_rest},
+  {"startup_power_loss", startup_power_loss},
+  {"moves_cycle", moves_cycle}
+#ifdef ACCEL_TUNE
+  , {"moves_cycle_tuned", moves_cycle_tuned}
+  , {"accel_tune_light", accel_tune_light}
+  , {"accel_tune_heavy", accel_tune_heavy}
+#endif
+#ifdef AXIS2
+  , {"axis2_job_4x", job}
+#endif
+#ifdef JOB_QUEUE
+  , {"job_queue_3", job_queue}
+#endif
+};
+const byte N_SCENARIOS = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+
+int main(int argc, char **argv)
+{
+  int i = 1;
+  const char *trace_prefix = 0;
+  while (i < argc && argv[i][0] == '-')
+  {
+    if (strcmp(argv[i], "-b") == 0)
+    {
+      BATTERY = 1;
+      i = i + 1;
+      continue;
+    }
+    if (i + 1 == argc)
+      break;
+    if (strcmp(argv[i], "-l") == 0)
+      LOOP_US = atol(argv[i + 1]);
+    else if (strcmp(argv[i], "-a") == 0)
+      ACCEL_I = atoi(argv[i + 1]);
+    else if (strcmp(argv[i], "-t") == 0)
+      trace_prefix = argv[i + 1];
+    else
+      break;
+    i = i + 2;
+  }
+  for (byte k = 0; k < N_SCENARIOS; k++)
+  {
+    byte selected = i == argc;
+    for (int j = i; j < argc; j++)
+      if (strcmp(argv[j], SCENARIOS[k].name) == 0)
+        selected = 1;
+    if (selected)
+    {
+      if (trace_prefix)
+        trace_open(trace_prefix, SCENARIOS[k].name);
+      SCENARIOS[k].run();
+      trace_close(SCENARIOS[k].name);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+"""Converting the sketch to a single C++ file, the way the Arduino IDE does it (host benchmark).
+
+Usage: ino2cpp.py SKETCH_DIR OUTPUT_FILE
+
+stacker.ino goes first, followed by the other *.ino files in alphabetical order. Prototypes for all the functions
+defined in the *.ino files are inserted right after the #include lines of stacker.ino.
+"""
+import glob
+import os
+import re
+import sys
+
+# A function definition header: return type and name at the start of the line, the argument list closed on the same line,
+# followed by the opening brace or the doc comment (that's how all the functions are written in the sketch):
+DEF = re.compile(r'^([A-Za-z_][\w \*]*?[\w\*])\s+(\**\w+)\s*\(([^;]*)\)\s*$')
+NOT_TYPES = ('else', 'return', 'if', 'while', 'for', 'switch', 'case', 'ISR')
+
+
+def main():
+    sketch_dir, out_file = sys.argv[1], sys.argv[2]
+    main_ino = os.path.join(sketch_dir, 'stacker.ino')
+    inos = [main_ino] + sorted(f for f in glob.glob(os.path.join(sketch_dir, '*.ino')) if f != main_ino)
+
+    lines = []
+    for f in inos:
+        lines.append('#line 1 "%s"' % os.path.abspath(f))
+        lines += open(f).read().split('\n')
+
+    prototypes = []
+    for i, line in enumerate(lines):
+        m = DEF.match(line)
+        if not m or m.group(1).split()[0] in NOT_TYPES:
+            continue
+        j = i + 1
+        while j < len(lines) and lines[j].strip() == '':
+            j += 1
+        if j < len(lines) and lines[j].lstrip().startswith(('{', '/*', '//')):
+            prototypes.append(line.strip() + ';')
+
+    # After the last #include of stacker.ino (all the types used in the prototypes are known by then):
+    last_include = max(i for i, line in enumerate(lines[:lines.index('#line 1 "%s"' % os.path.abspath(inos[1]))])
+                       if line.startswith('#include'))
+    out = (['#include "Arduino.h"'] + lines[:last_include + 1] + prototypes +
+           ['#line %d "%s"' % (last_include + 1, os.path.abspath(main_ino))] + lines[last_include + 1:])
+    with open(out_file, 'w') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+if __name__ == '__main__':
+    main()
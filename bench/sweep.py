@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+"""Parameter sweep of the motion settings (host benchmark): finding the fastest safe ones.
+
+Usage: sweep.py [options] SKETCH_DIR
+
+For every combination of SPEED_LIMIT_MM_S, SPEED_LIMIT2_MM_S, BREAKING_DISTANCE_MM, the ACCEL_FACTOR table, LIMITER_PAD and LIMITER_PAD2,
+the sketch is built into its own bench binary (these are compile-time constants of the sketch, so every combination is a separate program,
+with its own g), and the moves_cycle scenario is run for every acceleration factor of the table and every loop time (-l), both on AC
+power (SPEED_LIMIT) and on batteries (SPEED_LIMIT2). The combinations are built and run in parallel, one per core.
+
+Output: one line per combination, acceleration factor and loop time:
+  cycle_s, cycle2_s  - moves cycle time on AC power and on batteries, seconds
+  overshoot          - largest overshoot of a go_to() move, microsteps
+  margin             - smallest distance between the carriage and a limiting switch, microsteps (including full speed runs into both
+                       soft limits)
+  skip_pct           - skipped steps (motor_control() calls making up for more than one microstep), percent of the pulses
+  safe               - all the runs finished normally, no overshoot above --max-overshoot, margin at least --min-margin, and
+                       skipped steps at most --max-skip
+followed by the recommended stacker.h settings: the combination which is safe for every acceleration factor and every loop time, with the
+shortest cycle (AC plus batteries) for the factory default acceleration factor and the first loop time.
+"""
+import argparse
+import glob
+import json
+import multiprocessing
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+SETTINGS = ('SPEED_LIMIT_MM_S', 'SPEED_LIMIT2_MM_S', 'BREAKING_DISTANCE_MM', 'ACCEL_FACTOR', 'LIMITER_PAD', 'LIMITER_PAD2')
+# The lines of stacker.h holding the settings (all the rail profiles):
+PATTERNS = {
+    'SPEED_LIMIT_MM_S': r'^(constexpr float SPEED_LIMIT_MM_S = )[^;]*',
+    'SPEED_LIMIT2_MM_S': r'^(constexpr float SPEED_LIMIT2_MM_S = )[^;]*',
+    'BREAKING_DISTANCE_MM': r'^(constexpr float BREAKING_DISTANCE_MM = )[^;]*',
+    'ACCEL_FACTOR': r'^(const byte ACCEL_FACTOR\[N_ACCEL_FACTOR\] PROGMEM = )[^;]*',
+    'LIMITER_PAD': r'^(const COORD_TYPE LIMITER_PAD = )[^;]*',
+    'LIMITER_PAD2': r'^(const COORD_TYPE LIMITER_PAD2 = )[^;]*',
+}
+
+
+def stacker_h(text, combo):
+    """stacker.h with the settings of the combination."""
+    for name, value in zip(SETTINGS, combo):
+        if name == 'ACCEL_FACTOR':
+            text = re.sub(r'^(const byte N_ACCEL_FACTOR = )[^;]*', r'\g<1>%d' % len(value), text, flags=re.M)
+            value = '{%s}' % ', '.join(str(f) for f in value)
+        text, n = re.subn(PATTERNS[name], r'\g<1>%s' % value, text, flags=re.M)
+        if n == 0:
+            sys.exit('sweep.py: %s not found in stacker.h' % name)
+    return text
+
+
+def run_combo(job):
+    """Building the bench for one combination, and running it. Returns the combination and the list of rows (None if the build failed)."""
+    sketch_dir, combo, args = job
+    tmp = tempfile.mkdtemp(prefix='stacker_sweep_')
+    try:
+        for f in glob.glob(os.path.join(sketch_dir, '*.ino')) + glob.glob(os.path.join(sketch_dir, '*.cpp')) + \
+                glob.glob(os.path.join(sketch_dir, '*.h')):
+            shutil.copy(f, tmp)
+        with open(os.path.join(tmp, 'stacker.h')) as f:
+            text = f.read()
+        with open(os.path.join(tmp, 'stacker.h'), 'w') as f:
+            f.write(stacker_h(text, combo))
+        subprocess.check_call([sys.executable, os.path.join(BENCH_DIR, 'ino2cpp.py'), tmp, os.path.join(tmp, 'stacker_sketch.cpp')])
+        exe = os.path.join(tmp, 'stacker_bench')
+        cmd = (['g++', '-std=gnu++11', '-O2', '-Wall', '-Wextra'] + args.cflags.split() + ['-I', os.path.join(BENCH_DIR, 'arduino'), '-I', tmp,
+               os.path.join(BENCH_DIR, 'bench.cpp')] + [os.path.join(tmp, f) for f in ('Keypad.cpp', 'Key.cpp', 'pcd8544.cpp')] + ['-o', exe])
+        # A failed static_assert (e.g. the microstep interval is too short for the speed limit) means the combination is not possible:
+        if subprocess.call(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL) != 0:
+            return combo, None
+
+        rows = []
+        for i_accel in range(len(combo[3])):
+            for loop_us in args.loop_us:
+                res = []
+                for battery in ([], ['-b']):
+                    out = subprocess.check_output([exe, '-l', str(loop_us), '-a', str(i_accel)] + battery + ['moves_cycle'])
+                    res.append(json.loads(out.decode().splitlines()[0]))
+                rows.append(row(combo, i_accel, loop_us, res, args))
+        return combo, rows
+    finally:
+        shutil.rmtree(tmp)
+
+
+def row(combo, i_accel, loop_us, res, args):
+    """One line of the table, from the results on AC power and on batteries."""
+    r = {
+        'i_accel': i_accel,
+        'loop_us': loop_us,
+        'ok': all(x['ok'] for x in res),
+        'cycle_s': res[0]['t_stack_s'],
+        'cycle2_s': res[1]['t_stack_s'],
+        'overshoot': max(x['pos_error'] for x in res),
+        'margin': min(x['limiter_margin'] for x in res),
+        'skip_pct': max(100.0 * x['skipped_steps'] / max(x['pulses'], 1) for x in res),
+    }
+    r['safe'] = (r['ok'] and r['overshoot'] <= args.max_overshoot and r['margin'] >= args.min_margin and
+                 r['skip_pct'] <= args.max_skip)
+    return r
+
+
+def numbers(s, kind):
+    return [kind(x) for x in s.split(',')]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Parameter sweep of the motion settings (host benchmark).')
+    parser.add_argument('sketch_dir')
+    parser.add_argument('--speed', default='3,4,5,5.5', help='SPEED_LIMIT_MM_S values (comma separated)')
+    parser.add_argument('--speed2', default='1.5,2.5,3.5', help='SPEED_LIMIT2_MM_S values (only the ones not above SPEED_LIMIT_MM_S are used)')
+    parser.add_argument('--breaking', default='0.5,1,2,3', help='BREAKING_DISTANCE_MM values')
+    parser.add_argument('--accel-factor', nargs='+', default=['1,3,6'], help='ACCEL_FACTOR tables (each one comma separated)')
+    parser.add_argument('--pad', default='200,400', help='LIMITER_PAD values, microsteps')
+    parser.add_argument('--pad2', default='50,100', help='LIMITER_PAD2 values, microsteps')
+    parser.add_argument('--loop-us', default='200,400', help='loop times (bench -l), us; the first one is the nominal one')
+    parser.add_argument('--min-margin', type=int, default=100, help='smallest safe distance from a limiting switch, microsteps')
+    parser.add_argument('--max-overshoot', type=int, default=0, help='largest acceptable overshoot, microsteps')
+    parser.add_argument('--max-skip', type=float, default=0.0, help='largest acceptable rate of skipped steps, percent')
+    parser.add_argument('--cflags', default='', help='compile options of the sketch (e.g. "-DMICROSTEP_SWITCH")')
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count(), help='parallel builds and runs (default: all cores)')
+    args = parser.parse_args()
+    args.loop_us = numbers(args.loop_us, int)
+
+    combos = []
+    for speed in numbers(args.speed, float):
+        for speed2 in numbers(args.speed2, float):
+            if speed2 > speed:
+                continue
+            for breaking in numbers(args.breaking, float):
+                for table in args.accel_factor:
+                    for pad in numbers(args.pad, int):
+                        for pad2 in numbers(args.pad2, int):
+                            combos.append((speed, speed2, breaking, tuple(numbers(table, int)), pad, pad2))
+
+    # The factory default acceleration factor (its index in the table):
+    with open(os.path.join(args.sketch_dir, 'initialize.ino')) as f:
+        i_default = int(re.search(r'g\.i_accel_factor = (\d+);', f.read()).group(1))
+
+    print('%6s %6s %6s %10s %5s %5s %6s %7s %8s %8s %9s %6s %8s %4s' % ('speed', 'speed2', 'break', 'accel_f', 'pad', 'pad2', 'factor',
+          'loop_us', 'cycle_s', 'cycle2_s', 'overshoot', 'margin', 'skip_pct', 'safe'))
+    best = None
+    pool = multiprocessing.Pool(args.jobs)
+    for combo, rows in pool.imap_unordered(run_combo, [(args.sketch_dir, c, args) for c in combos]):
+        head = '%6g %6g %6g %10s %5d %5d' % (combo[0], combo[1], combo[2], ','.join(str(f) for f in combo[3]), combo[4], combo[5])
+        if rows is None:
+            print('%s  build failed (static_assert)' % head)
+            continue
+        for r in rows:
+            print('%s %6d %7d %8.3f %8.3f %9d %6d %8.3f %4s' % (head, combo[3][r['i_accel']], r['loop_us'], r['cycle_s'], r['cycle2_s'],
+                  r['overshoot'], r['margin'], r['skip_pct'], 'yes' if r['safe'] else 'no'))
+        sys.stdout.flush()
+        if not all(r['safe'] for r in rows):
+            continue
+        nominal = [r for r in rows if r['i_accel'] == min(i_default, len(combo[3]) - 1) and r['loop_us'] == args.loop_us[0]][0]
+        # The shortest cycle; then the smallest paddings (the longest usable rail travel):
+        key = (round(nominal['cycle_s'] + nominal['cycle2_s'], 2), combo[4] + combo[5])
+        if best is None or key < best[0]:
+            best = (key, combo, nominal, min(r['margin'] for r in rows))
+    pool.close()
+
+    if best is None:
+        print('\nNo safe combination.')
+        return
+    key, combo, nominal, margin = best
+    print('\n// Recommended settings (moves cycle %.3f s on AC power, %.3f s on batteries; limiter margin %d microsteps):' %
+          (nominal['cycle_s'], nominal['cycle2_s'], margin))
+    print('constexpr float SPEED_LIMIT_MM_S = %g;' % combo[0])
+    print('constexpr float SPEED_LIMIT2_MM_S = %g;' % combo[1])
+    print('constexpr float BREAKING_DISTANCE_MM = %g;' % combo[2])
+    print('const byte ACCEL_FACTOR[N_ACCEL_FACTOR] PROGMEM = {%s};' % ', '.join(str(f) for f in combo[3]))
+    print('const COORD_TYPE LIMITER_PAD = %d;' % combo[4])
+    print('const COORD_TYPE LIMITER_PAD2 = %d;' % combo[5])
+
+
+if __name__ == '__main__':
+    main()
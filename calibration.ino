@@ -10,6 +10,27 @@ void calibration()
   if (g.calibrate == 0 || g.moving == 1 || g.breaking == 1 || g.calibrate_warning == 1 || g.backlashing == 1 || g.error > 0)
     return;
 
+#ifdef HOMING
+  // We just stopped after hitting a limiter at full speed; g.limit_tmp is refined with the two-speed homing before being used below:
+  if (g.calibrate_flag == 1 || g.calibrate_flag == 5)
+  {
+    if (g.homing_flag == 0)
+    {
+      // Direction to the limiter we hit (calibrate=1 is only left to do after hitting the background limiter first):
+      if ((g.calibrate == 1) == (g.calibrate_flag == 1))
+        g.homing_dir = 1;
+      else
+        g.homing_dir = -1;
+      g.homing_i = 0;
+      g.homing_flag = 1;
+    }
+    if (g.homing_flag < 5)
+      return;
+    // Homing is done:
+    g.homing_flag = 0;
+  }
+#endif
+
   if (g.calibrate == 3 && g.calibrate_flag == 0)
     // The very first calibration
   {
@@ -75,4 +96,90 @@ void calibration()
   return;
 }
 
-
+
+#ifdef HOMING
+void homing()
+/* Two-speed homing of the limiter we just hit at full speed during calibration (initiated in calibration()):
+   back off by HOMING_BACKOFF microsteps, re-approach the limiter at HOMING_SPEED_MM_S, and latch the position where it goes on.
+   Repeated N_HOMING times; the average latched position replaces g.limit_tmp, and the spread is the measured repeatability.
+   Backlash compensation is off during calibration, but all the slow approaches are done in the same direction, so the
+   backlash is always taken up in the same way when the limiter goes on.
+ */
+{
+  byte i;
+  COORD_TYPE pos_min, pos_max;
+  long sum;
+
+  if (g.homing_flag == 0 || g.homing_flag == 5 || g.error > 0)
+    return;
+
+  // Everything except for the slow approach is only done at rest:
+  if (g.homing_flag != 3 && (g.moving || g.started_moving || g.breaking))
+    return;
+
+  switch (g.homing_flag)
+  {
+    case 1: // Backing off from the position where the limiter went on
+      go_to((float)(g.limit_tmp - g.homing_dir * HOMING_BACKOFF) + 0.5, g.speed_limit);
+      g.homing_flag = 2;
+      break;
+
+    case 2: // Starting the slow approach
+      if (digitalRead(PIN_LIMITERS) == HIGH)
+        // Still not backed off enough:
+      {
+        go_to((float)(g.pos_short_old - g.homing_dir * HOMING_BACKOFF) + 0.5, g.speed_limit);
+        break;
+      }
+      g.homing_start = g.pos_short_old;
+      change_speed(g.homing_dir * SPEED_SCALE * HOMING_SPEED_MM_S, 0, 2);
+      g.homing_flag = 3;
+      break;
+
+    case 3: // Slow approach, until the limiter goes on
+      if (digitalRead(PIN_LIMITERS) == HIGH)
+      {
+        g.homing_pos[g.homing_i] = g.pos_short_old;
+        g.homing_i++;
+        change_speed(0.0, 0, 2);
+        g.homing_flag = 4;
+      }
+      else if (g.homing_dir * (g.pos_short_old - g.homing_start) > 4 * HOMING_BACKOFF)
+        // The limiter should have gone on long ago; keeping the full speed value of g.limit_tmp:
+      {
+        change_speed(0.0, 0, 2);
+        g.homing_flag = 5;
+        display_comment_line("Homing failed ");
+      }
+      break;
+
+    case 4: // Latched; either one more slow approach, or done
+      if (g.homing_i < N_HOMING)
+      {
+        go_to((float)(g.homing_pos[g.homing_i - 1] - g.homing_dir * HOMING_BACKOFF) + 0.5, g.speed_limit);
+        g.homing_flag = 2;
+        break;
+      }
+      sum = 0;
+      pos_min = g.homing_pos[0];
+      pos_max = g.homing_pos[0];
+      for (i = 0; i < N_HOMING; i++)
+      {
+        sum = sum + g.homing_pos[i];
+        if (g.homing_pos[i] < pos_min)
+          pos_min = g.homing_pos[i];
+        if (g.homing_pos[i] > pos_max)
+          pos_max = g.homing_pos[i];
+      }
+      g.limit_tmp = roundMy((float)sum / (float)N_HOMING);
+      if (g.homing_dir > 0)
+        g.homing_rep[1] = pos_max - pos_min;
+      else
+        g.homing_rep[0] = pos_max - pos_min;
+      g.homing_flag = 5;
+      break;
+  }
+
+  return;
+}
+#endif
@@ -8,8 +8,16 @@ void camera()
   if (g.error > 0)
     return;
 
+#ifdef JOB_QUEUE
+  // The next job of the queue, once the rail is at rest:
+  job_go();
+#endif
 
-  if (g.stacker_mode == 1 && g.moving == 0 && g.started_moving == 0 && g.backlashing == 0 && g.start_stacking == 0)
+  if (g.stacker_mode == 1 && g.moving == 0 && g.started_moving == 0 && g.backlashing == 0 && g.start_stacking == 0
+#ifdef AXIS2
+      && g.y_moving == 0
+#endif
+     )
     // We are here if the rail had to travel to the starting point for stacking, and now is ready for stacking
   {
     g.t0_mil = millis();
@@ -24,12 +32,19 @@ void camera()
     {
       g.noncont_flag = 1;
       letter_status("S");
+#ifdef FLASH_SYNC
+      flash_init();
+#endif
     }
     // Time when stacking was initiated:
     g.t0_stacking = g.t;
     g.frame_counter = 0;
     display_frame_counter();
     g.pos_to_shoot = g.pos_short_old;
+#ifdef SERPENTINE
+    if (g.reverse_pass)
+      g.pos_to_shoot = shot_coordinate();
+#endif
     g.stacker_mode = 2;
   }
 
@@ -42,8 +57,21 @@ void camera()
     {
       // Required microsteps per frame:
       g.msteps_per_frame = Msteps_per_frame();
+#ifdef CAMERA_BUFFER
+      // Camera buffer model: the frame counter value when to slow down to the sustained frame rate:
+      g.burst_frame = burst_plan();
+      // The required speed in microsteps per microsecond:
+      speed = SPEED_SCALE * camera_fps(g.frame_counter >= g.burst_frame) * mm_per_frame();
+#else
       // Estimating the required speed in microsteps per microsecond
       speed = target_speed();
+#endif
+#ifdef STOP_AND_GO
+      // Slowing down for each shot, if the rail would move too much during the exposure (see stop_and_go()):
+      g.sng_flag = speed > STOP_AND_GO_SPEED;
+      if (g.sng_flag)
+        speed = STOP_AND_GO_SPEED;
+#endif
       if (g.stacker_mode == 3)
         // 1-point stacking
       {
@@ -61,14 +89,24 @@ void camera()
   // Non-continuous stacking mode
   if (g.continuous_mode == 0 && g.start_stacking == 3 && g.moving == 0 && g.started_moving == 0 && g.stacker_mode == 2)
   {
-    if (g.noncont_flag == 2 && g.t - g.t_shot > FIRST_DELAY[g.i_first_delay] * 1e6)
+#ifdef SETTLE_MODEL
+    if (g.noncont_flag == 2 && g.t - g.t_shot > settle_delay() * 1e6)
+#else
+    if (g.noncont_flag == 2 && g.t - g.t_shot > first_delay() * 1e6)
+#endif
     {
       g.noncont_flag = 3;
       // Initiating the second camera trigger (actual shot) in MIRROR_LOCK situation, or the only shot otherwise:
       g.make_shot = 1;
       g.t_shot = g.t;
+#ifdef FLASH_SYNC
+      g.flash = 1;
     }
-    else if (g.noncont_flag == 3 && g.t - g.t_shot > SECOND_DELAY[g.i_second_delay] * 1e6)
+    else if (g.noncont_flag == 3 && flash_sync())
+#else
+    }
+    else if (g.noncont_flag == 3 && g.t - g.t_shot > second_delay() * 1e6)
+#endif
     {
       if (g.frame_counter < g.Nframes)
       {
@@ -86,10 +124,18 @@ void camera()
         display_frame_counter();
         letter_status(" ");
         g.end_of_stacking = 1;
+#ifdef FAST_STARTUP
+        // The boot record wasn't saved between the frames:
+        boot_save();
+#endif
       }
     }
   }
 
+  // Display refresh, position saving and coordinate recalibration deferred by stop_now() (once the rail is at rest; in non-continuous stacking,
+  // while waiting for the rail to settle or for the exposure to end):
+  deferred_updates();
+
   // Triggering camera shutter when needed
   // This block is shared between continuous and non-continuous modes (in the latter case, it does the first shutter trigger, to lock the mirror)
   if (g.stacker_mode >= 2 && g.backlashing == 0 && g.start_stacking == 3)
@@ -108,8 +154,12 @@ void camera()
       display_frame_counter();
       g.frame_counter++;
       // Position at which to shoot the next shot:
+#ifdef SERPENTINE
+      g.pos_to_shoot = shot_coordinate();
+#else
       g.pos_to_shoot = frame_coordinate();
-      if (g.stacker_mode == 3 && g.frame_counter == N_SHOTS[g.i_n_shots])
+#endif
+      if (g.stacker_mode == 3 && g.frame_counter == n_shots())
       {
         // End of one-point stacking
         change_speed(0.0, 0, 2);
@@ -117,6 +167,11 @@ void camera()
         g.frame_counter = 0;
         display_frame_counter();
       }
+#ifdef STOP_AND_GO
+      if (g.sng_flag)
+        // Keeping the slow speed until the end of the exposure:
+        g.sng_flag = 2;
+#endif
       if (g.continuous_mode == 0)
         g.noncont_flag = 2;
       else if (g.stacker_mode == 2 && g.frame_counter == g.Nframes)
@@ -126,9 +181,30 @@ void camera()
         display_frame_counter();
         g.end_of_stacking = 1;
       }
+#ifdef CAMERA_BUFFER
+      if (g.continuous_mode && g.stacker_mode >= 2 && g.frame_counter == g.burst_frame
+#ifdef STOP_AND_GO
+          // (with stop-and-go, the frame rate is applied to every frame separately)
+          && g.sng_flag == 0
+#endif
+         )
+      {
+        // The camera buffer will be full soon; slowing down to the sustained frame rate:
+        speed = SPEED_SCALE * camera_fps(1) * mm_per_frame();
+        if (g.stacker_mode == 3)
+          go_to((float)g.limit2 + 0.5, speed);
+        else
+          go_to((float)g.destination_point + 0.5, speed);
+      }
+#endif
     }
   }
 
+#ifdef STOP_AND_GO
+  // Speed changes between the frames in the stop-and-go continuous stacking:
+  stop_and_go();
+#endif
+
 
   if (g.paused && g.noncont_flag == 2 && g.mirror_lock == 1)
     // We paused when the mirror is locked; release the lock right away
@@ -142,18 +218,15 @@ void camera()
   // Making decisions regarding whether to turn AF and shutter on or off:
 
   // Triggering camera's AF:
-  if (g.start_stacking == 1 || g.AF_on == 0 && g.make_shot == 1 && (g.continuous_mode == 0 || g.single_shot == 1 || AF_SYNC))
+  if (g.start_stacking == 1 || (g.AF_on == 0 && g.make_shot == 1 && (g.continuous_mode == 0 || g.single_shot == 1 || AF_SYNC)))
   {
     // Switching camera's AF on
-    if (g.continuous_mode == 1 && g.start_stacking == 1 || g.AF_on == 0 && g.make_shot == 1 && (g.continuous_mode == 0 || g.single_shot == 1 || AF_SYNC))
+    if ((g.continuous_mode == 1 && g.start_stacking == 1) || (g.AF_on == 0 && g.make_shot == 1 && (g.continuous_mode == 0 || g.single_shot == 1 || AF_SYNC)))
     {
       // Initiating AF now:
       digitalWrite(PIN_AF, HIGH);
       g.t_AF = g.t;
       g.AF_on = 1;
-#ifdef CAMERA_DEBUG
-      AF_status(1);
-#endif
       g.single_shot = 0;
     }
     if (g.start_stacking == 1)
@@ -161,13 +234,10 @@ void camera()
   }
 
   // Triggering camera's shutter:
-  if (g.make_shot == 1 && g.AF_on == 1 && ((g.mirror_lock < 2 && g.t - g.t_AF >= SHUTTER_ON_DELAY) || (g.mirror_lock == 2 && g.t - g.t_AF >= SHUTTER_ON_DELAY2)))
+  if (g.make_shot == 1 && g.AF_on == 1 && ((g.mirror_lock < 2 && g.t - g.t_AF >= SHUTTER_ON_DELAY) || (g.mirror_lock == 2 && g.t - g.t_AF >= (unsigned long)SHUTTER_ON_DELAY2)))
   {
 #ifndef DISABLE_SHUTTER
     digitalWrite(PIN_SHUTTER, HIGH);
-#endif
-#ifdef CAMERA_DEBUG
-    shutter_status(1);
 #endif
     g.shutter_on = 1;
     g.t_shutter = g.t;
@@ -180,9 +250,6 @@ void camera()
     // Releasing the shutter:
 #ifndef DISABLE_SHUTTER
     digitalWrite(PIN_SHUTTER, LOW);
-#endif
-#ifdef CAMERA_DEBUG
-    shutter_status(0);
 #endif
     g.shutter_on = 0;
     g.t_shutter_off = g.t;
@@ -190,33 +257,43 @@ void camera()
 
   // Depress the camera's AF when it's no longer needed
   // and only if the shutter has been off for at least SHUTTER_OFF_DELAY microseconds:
-  if (g.make_shot == 0 && g.AF_on == 1 && g.shutter_on == 0 && ((g.mirror_lock < 2 && g.t - g.t_shutter_off >= SHUTTER_OFF_DELAY) || (g.mirror_lock == 2 && g.t - g.t_shutter_off >= SHUTTER_OFF_DELAY2)) &&
+  if (g.make_shot == 0 && g.AF_on == 1 && g.shutter_on == 0 && ((g.mirror_lock < 2 && g.t - g.t_shutter_off >= SHUTTER_OFF_DELAY) || (g.mirror_lock == 2 && g.t - g.t_shutter_off >= (unsigned long)SHUTTER_OFF_DELAY2)) &&
       (g.continuous_mode == 0 || g.stacker_mode == 0 || g.paused == 1 || AF_SYNC))
   {
     digitalWrite(PIN_AF, LOW);
-#ifdef CAMERA_DEBUG
-    AF_status(0);
-#endif
     g.AF_on = 0;
     g.single_shot = 0;
   }
 
 
-  // Timelapse module:
-  if (g.end_of_stacking && g.moving == 0 && g.paused == 0)
+  // Timelapse module (after the backlash compensation leg, if any):
+  if (g.end_of_stacking && g.moving == 0 && g.backlashing == 0 && g.paused == 0)
   {
-    if (g.timelapse_counter < N_TIMELAPSE[g.i_n_timelapse] - 1)
+#ifdef JOB_QUEUE
+    // Progress of the job queue (the stacks done in the current job):
+    job_save(g.timelapse_counter + 1);
+#endif
+#ifdef AXIS2
+    // In the job mode, all the lateral positions are done before the next timelapse stack:
+    if (job_y_next())
+      return;
+#endif
+    if (g.timelapse_counter < n_timelapse() - 1)
     {
       // Special stacker mode: waiting between stacks in a timelapse sequence:
       g.stacker_mode = 4;
       g.t_mil = millis();
-      if (((float)(g.t_mil - g.t0_mil)) / 1000.0 > (float)DT_TIMELAPSE[g.i_dt_timelapse])
+      if (((float)(g.t_mil - g.t0_mil)) / 1000.0 > (float)dt_timelapse())
         // We are initiating the next stacking in the timelapse sequence
       {
         g.end_of_stacking = 0;
         g.t0_mil = g.t_mil;
         g.timelapse_counter++;
+#ifdef SERPENTINE
+        serpentine_start();
+#else
         go_to((float)g.point1 + 0.5, g.speed_limit);
+#endif
         g.stacker_mode = 1;
         g.start_stacking = 0;
       }
@@ -224,10 +301,17 @@ void camera()
     else
       // End of timelapse, or when no timelapse (N_timelapse=1)
     {
+#ifdef JOB_QUEUE
+      if (job_next())
+        return;
+#endif
       g.end_of_stacking = 0;
       g.timelapse_mode = 0;
       display_all();
     }
+#ifdef FLASH_SYNC
+    flash_report();
+#endif
   }
 
   return;
@@ -0,0 +1,53 @@
+/* Timebase of the sketch: the time in microseconds, used for the equation of motion and all the camera and display timings.
+
+   Without TIMER1_CLOCK it is micros() (4 us resolution). With TIMER1_CLOCK, Timer1 runs free at F_CPU/8 (0.5 us ticks, overflowing every
+   32.768 ms), and its overflow interrupt counts the overflows; the time is put together from the two, with 1 us resolution. Either way it wraps
+   around every 2^32 us (71.6 min), so the differences of two times (unsigned long) are correct across the wrap as long as the interval is shorter
+   than that; the longer intervals (between the stacks of a timelapse) are measured with millis(). The time is read once per loop, in
+   motor_control() (g.t), and the other modules use that value; only the idle sleep and the interrupts read the clock themselves.
+*/
+
+#ifdef TIMER1_CLOCK
+void clock_init()
+/* Starting Timer1 in the normal mode (counting up to 0xFFFF), prescaler 8, with the overflow interrupt. Called at the start of setup().
+ */
+{
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(CS11);
+  TCNT1 = 0;
+  g.t1_ovf = 0;
+  // Clearing a pending overflow (by writing 1):
+  TIFR1 = _BV(TOV1);
+  TIMSK1 = _BV(TOIE1);
+  interrupts();
+  return;
+}
+
+
+ISR(TIMER1_OVF_vect)
+{
+  g.t1_ovf++;
+}
+#endif
+
+
+unsigned long clock_us()
+/* The current time in microseconds. Can also be called from an interrupt.
+ */
+{
+#ifdef TIMER1_CLOCK
+  byte sreg = SREG;
+  cli();
+  unsigned short tcnt = TCNT1;
+  unsigned long ovf = g.t1_ovf;
+  // The counter overflowed after the interrupts were disabled (the interrupt is pending); the counter was read after the overflow if it is small:
+  if ((TIFR1 & _BV(TOV1)) && tcnt < 0x8000)
+    ovf++;
+  SREG = sreg;
+  // One overflow is 2^16 ticks = 2^15 us:
+  return (ovf << 15) + (tcnt >> 1);
+#else
+  return micros();
+#endif
+}
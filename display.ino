@@ -8,11 +8,13 @@ void display_stuff()
   {
     g.comment_flag = 0;
     if (g.moving == 0)
+    {
       if (g.alt_flag)
         display_all();
       else
         display_current_position();
 //        display_all();
+    }
   }
 
   // Refreshing battery status regularly (only when not moving, as it is slow):
@@ -20,6 +22,9 @@ void display_stuff()
   {
     g.t_display = g.t;
     battery_status();
+#ifdef IDLE_SLEEP
+    duty_cycle();
+#endif
   }
 
   return;
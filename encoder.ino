@@ -0,0 +1,185 @@
+#ifdef ENCODER
+/* Closed-loop position verification with a quadrature encoder on the motor shaft.
+
+   The encoder is decoded by the PCINT0 interrupt (shared with LIMITER_INT and IDLE_SLEEP): every edge of the channel A is one count, and the
+   channel B level gives the direction. The encoder position (in microsteps) is g.enc_offset plus the counts scaled by ENCODER_MSTEPS; it is
+   compared with the commanded position (g.pos_short_old) in every loop while moving, and once at the end of every move.
+   The encoder sees the motor, not the carriage, so the backlash compensation works the same way as without it.
+*/
+
+void encoder_count()
+/* Called from the PCINT0 interrupt: counting the edges of the encoder channel A (the interrupt also fires for the other pins of the port).
+ */
+{
+  byte a = (PINB & _BV(PINB1)) != 0;
+  if (a == g.enc_a)
+    return;
+  g.enc_a = a;
+  // Channel A is ahead of B when the motor turns forward:
+  if (a == ((PIND & _BV(PIND1)) != 0))
+    g.enc_count--;
+  else
+    g.enc_count++;
+}
+
+
+void encoder_sync()
+/* Making the current rail position the reference for the encoder (when the rail position is read from EEPROM).
+ */
+{
+  noInterrupts();
+  g.enc_count = 0;
+  g.enc_a = (PINB & _BV(PINB1)) != 0;
+  interrupts();
+  g.enc_offset = g.pos_short_old;
+  g.enc_flag = 0;
+  g.enc_retries = 0;
+  g.enc_lost = 0;
+  g.t_slip = g.t - ENCODER_STALL_DT;
+  return;
+}
+
+
+COORD_TYPE encoder_position()
+/* The rail position measured by the encoder, in microsteps.
+ */
+{
+  long count;
+  noInterrupts();
+  count = g.enc_count;
+  interrupts();
+  // The motor turns the other way for the same direction of the reversed rail:
+  if (g.straight == 0)
+    count = -count;
+  return g.enc_offset + ENCODER_SIGN * ENCODER_MSTEPS * count;
+}
+
+
+void encoder_shift(COORD_TYPE d)
+/* Shifting the rail coordinates by d microsteps, to the position measured by the encoder. The equation of motion is shifted as well, and the
+   target (g.pos_goto) is not changed, so a moving rail simply travels d microsteps more (or less) to the same target.
+ */
+{
+  g.pos = g.pos + (float)d;
+  g.pos0 = g.pos0 + (float)d;
+  g.pos_old = g.pos_old + (float)d;
+  g.pos_stop_old = g.pos_stop_old + (float)d;
+#ifdef INPUT_SHAPER
+  shaper_shift((float)d);
+#endif
+#ifdef LIMITER_INT
+  noInterrupts();
+  g.pos_short_old = g.pos_short_old + d;
+  interrupts();
+#else
+  g.pos_short_old = g.pos_short_old + d;
+#endif
+  g.enc_lost = g.enc_lost + abs(d);
+
+  // The rail was already decelerating to the go_to target, and would now stop d microsteps short of it; speeding up again (the breaking
+  // will be initiated again in motor_control(), at the right place):
+  if (g.moving && g.moving_mode == 1 && g.speed1 == 0.0 && g.breaking == 0)
+  {
+    change_speed(g.pos_goto > g.pos ? g.speed_limit : -g.speed_limit, 1, 2);
+    g.pos_stop_flag = 0;
+  }
+  return;
+}
+
+
+void encoder_stall()
+/* The motor stalled: emergency breaking if still moving, and no more stacking. The coordinates will follow the encoder once the rail is at rest.
+ */
+{
+  if (g.moving && g.breaking == 0)
+  {
+    change_speed(0.0, 0, 2);
+    g.breaking = 1;
+    letter_status("B");
+  }
+  display_comment_line("Motor stalled!");
+  g.stacker_mode = 0;
+  if (g.moving)
+    g.enc_flag = 2;
+  g.enc_retries = 0;
+  g.enc_lost = 0;
+  return;
+}
+
+
+void encoder_check()
+/* Comparing the encoder position with the commanded one: slips are corrected while moving, and the final position is verified (and corrected
+   with an extra move if needed) once the rail is at rest.
+ */
+{
+  // At rest, only once after each move:
+  if (g.moving == 0 && (g.enc_flag == 0 || g.started_moving))
+    return;
+
+  // The limiters, homing and the backlash measurement rely on the commanded position; the rail is not moved when they are in action:
+  byte fix = g.error == 0 && g.calibrate_flag == 0;
+#ifdef HOMING
+  fix = fix && g.homing_flag == 0;
+#endif
+#ifdef BL_MAP_DEBUG
+  fix = fix && g.bl_cal_flag == 0;
+#endif
+
+  COORD_TYPE d = encoder_position() - g.pos_short_old;
+
+  if (g.moving)
+  {
+    if (abs(d) < ENCODER_SLIP)
+      return;
+    // The motor slipped: from now on the coordinates follow the encoder
+    encoder_shift(d);
+    if (fix && g.breaking == 0 && g.t - g.t_slip < ENCODER_STALL_DT)
+      encoder_stall();
+    g.t_slip = g.t;
+    return;
+  }
+
+  // Verifying the final position of a move:
+  byte flag = g.enc_flag;
+  g.enc_flag = 0;
+
+  if (abs(d) > ENCODER_TOLERANCE)
+  {
+    COORD_TYPE pos_target = g.pos_short_old;
+    encoder_shift(d);
+    EEPROM.put( ADDR_POS, g.pos );
+#ifdef FAST_STARTUP
+    boot_save();
+#endif
+    if (flag == 1 && fix)
+    {
+      if (g.enc_retries < ENCODER_RETRIES)
+      {
+        // Correction move, with the usual backlash compensation (the shot in stacking waits until the rail is back at pos_to_shoot):
+        g.enc_retries++;
+        go_to((float)pos_target + 0.5, g.speed_limit);
+        return;
+      }
+      encoder_stall();
+      return;
+    }
+  }
+  g.enc_retries = 0;
+
+  if (g.enc_lost > 0 && flag == 1)
+  {
+    sprintf(g.buffer, "Lost %4d mstp", (int)constrain(g.enc_lost, 0, 9999));
+    display_comment_line(g.buffer);
+  }
+  g.enc_lost = 0;
+  return;
+}
+
+
+#if !defined(LIMITER_INT) && !defined(IDLE_SLEEP)
+ISR(PCINT0_vect)
+{
+  encoder_count();
+}
+#endif
+#endif
@@ -0,0 +1,108 @@
+#ifdef FLASH_SYNC
+/* Closed-loop non-continuous stacking, using the camera's flash sync signal on PIN_FLASH.
+
+   The flash sync pin goes LOW at the start of the exposure. The falling edge is latched (with its time) by the PCINT0 interrupt, shared with
+   LIMITER_INT and IDLE_SLEEP, so even a short pulse from a flash sensor is not missed between two loops. camera() then waits only
+   FLASH_SYNC_DELAY after the signal, instead of the fixed SECOND_DELAY, before moving the rail to the next frame.
+*/
+
+void flash_init()
+/* Called when a non-continuous stack is initiated: resetting the flash sync statistics.
+ */
+{
+  g.flash = 0;
+  g.flash_retries = 0;
+  g.flash_n = 0;
+  g.flash_missed = 0;
+  g.flash_sum = 0;
+  g.flash_max = 0;
+  return;
+}
+
+
+void flash_latch()
+/* Called from the PCINT0 interrupt: latching the time of the flash sync signal (PIN_FLASH going LOW), once per shot.
+ */
+{
+  if (g.flash == 1 && (PINB & _BV(PINB1)) == 0)
+  {
+    g.t_flash = clock_us();
+    g.flash = 2;
+  }
+}
+
+
+byte flash_sync()
+/* Called in non-continuous stacking after the shot was initiated (noncont_flag=3). Returns 1 when the rail can move to the next frame:
+   FLASH_SYNC_DELAY after the flash sync signal, or when there was no signal within SECOND_DELAY and the shot was already retried FLASH_RETRIES times.
+   Otherwise a shot without the signal within SECOND_DELAY is retried.
+ */
+{
+  byte flash;
+  unsigned long t_flash;
+  noInterrupts();
+  flash = g.flash;
+  t_flash = g.t_flash;
+  interrupts();
+
+  if (flash == 2)
+  {
+    // The interrupt could have happened after g.t was measured:
+    if ((long)(g.t - t_flash) < (long)FLASH_SYNC_DELAY)
+      return 0;
+    unsigned long dt = t_flash - g.t_shutter;
+    g.flash_n++;
+    g.flash_sum = g.flash_sum + dt;
+    if (dt > g.flash_max)
+      g.flash_max = dt;
+    g.flash = 0;
+    g.flash_retries = 0;
+    return 1;
+  }
+
+  if (g.t - g.t_shot <= second_delay() * 1e6)
+    return 0;
+
+  // No flash sync signal - the shot was missed:
+  g.flash_missed++;
+  if (g.flash_retries < FLASH_RETRIES)
+  {
+    g.flash_retries++;
+    g.make_shot = 1;
+    g.t_shot = g.t;
+    g.flash = 1;
+    return 0;
+  }
+  // Giving up on this frame:
+  g.flash = 0;
+  g.flash_retries = 0;
+  return 1;
+}
+
+
+void flash_report()
+/* Called at the end of each stack: displaying the shutter-to-flash latency (average/maximum, ms) and the number of missed shots of the
+   non-continuous stack in the comment line. Only done once per stack.
+ */
+{
+  if (g.flash_n == 0 && g.flash_missed == 0)
+    return;
+  if (g.flash_n == 0)
+    sprintf(g.buffer, "No flash sync!");
+  else
+    snprintf(g.buffer, sizeof(g.buffer), "L%3d/%3dms M%-2d", (short)min(g.flash_sum / g.flash_n / 1000, 999UL),
+             (short)min(g.flash_max / 1000, 999UL), (short)constrain(g.flash_missed, 0, 99));
+  display_comment_line(g.buffer);
+  g.flash_n = 0;
+  g.flash_missed = 0;
+  return;
+}
+
+
+#if !defined(LIMITER_INT) && !defined(IDLE_SLEEP)
+ISR(PCINT0_vect)
+{
+  flash_latch();
+}
+#endif
+#endif
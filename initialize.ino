@@ -4,6 +4,11 @@ void initialize(byte factory_reset)
 {
   g.error = 0;
   g.calibrate_warning = 0;
+#ifdef FAST_STARTUP
+  g.t_boot = millis();
+  g.boot_flag = 1;
+  byte no_backlash_loop = 0;
+#endif
   
 #ifndef DISABLE_SHUTTER    
   digitalWrite(PIN_SHUTTER, LOW);
@@ -41,6 +46,51 @@ void initialize(byte factory_reset)
   g.direction = 1;
   g.comment_flag = 0;
 
+#ifdef BL_MAP
+  // The backlash map is needed by update_backlash():
+  if (factory_reset)
+  {
+    for (byte i = 0; i < N_BL_MAP; i++)
+      g.bl_map[i] = BACKLASH;
+    EEPROM.put( ADDR_BL_MAP, g.bl_map);
+  }
+  else
+  {
+    EEPROM.get( ADDR_BL_MAP, g.bl_map);
+    // Not measured yet (EEPROM written by an older version of the firmware):
+    for (byte i = 0; i < N_BL_MAP; i++)
+      if (g.bl_map[i] < (COORD_TYPE)0 || g.bl_map[i] > (COORD_TYPE)10000)
+        g.bl_map[i] = BACKLASH;
+  }
+#endif
+#ifdef BL_MAP_DEBUG
+  g.bl_cal_flag = 0;
+#endif
+#ifdef ACCEL_TUNE
+  g.tune_flag = 0;
+#endif
+#ifdef AXIS2
+  if (factory_reset)
+  {
+    g.i_n_y = 0;
+    EEPROM.put( ADDR_I_N_Y, g.i_n_y);
+  }
+  else
+  {
+    EEPROM.get( ADDR_I_N_Y, g.i_n_y);
+    // EEPROM written by an older version of the firmware:
+    if (g.i_n_y >= N_N_Y)
+      g.i_n_y = 0;
+  }
+  g.y_counter = 0;
+#endif
+#ifdef HOMING
+  g.homing_flag = 0;
+  g.homing_report = 0;
+  g.homing_rep[0] = 0;
+  g.homing_rep[1] = 0;
+#endif
+
   if (factory_reset)
   {
 #ifdef MOTOR_DEBUG
@@ -59,6 +109,15 @@ void initialize(byte factory_reset)
     g.i_accel_factor = 1;
     g.i_n_timelapse = 0;
     g.i_dt_timelapse = 5;
+#ifdef CAMERA_BUFFER
+    g.i_camera = 0;
+#endif
+#ifdef INPUT_SHAPER
+    g.i_shaper = 0;
+#endif
+#ifdef ACCEL_TUNE
+    g.i_accel_tune = ACCEL_TUNE_DEFAULT;
+#endif
     g.mirror_lock = 1;
     g.backlash_on = 1;
     update_backlash();
@@ -85,7 +144,35 @@ void initialize(byte factory_reset)
     EEPROM.put( ADDR_REG3, g.reg);
     EEPROM.put( ADDR_REG4, g.reg);
     EEPROM.put( ADDR_REG5, g.reg);
+#ifdef CAMERA_BUFFER
+    for (byte i = 0; i < 5; i++)
+      EEPROM.put( ADDR_I_CAMERA_REG + i, g.i_camera);
+#endif
+#ifdef INPUT_SHAPER
+    for (byte i = 0; i < 5; i++)
+      EEPROM.put( ADDR_I_SHAPER_REG + i, g.i_shaper);
+#endif
+#ifdef ACCEL_TUNE
+    for (byte i = 0; i < 5; i++)
+      EEPROM.put( ADDR_I_ACCEL_TUNE_REG + i, g.i_accel_tune);
+#endif
+#ifdef FAST_STARTUP
+    // No boot record (zero rail length):
+    boot_record r = {};
+    EEPROM.put( ADDR_BOOT, r);
+    EEPROM.put( ADDR_BOOT_CLEAN, (byte)0);
+    g.boot_clean = 0;
+#endif
     put_reg();
+#ifdef SETTLE_MODEL
+    EEPROM.put( ADDR_SETTLE, SETTLE_DEFAULT);
+#endif
+#ifdef JOB_QUEUE
+    g.job_n = 0;
+    g.job_i = 0;
+    EEPROM.put( ADDR_JOB_N, g.job_n);
+    EEPROM.put( ADDR_JOB_I, g.job_i);
+#endif
   }
   else
   {
@@ -96,10 +183,36 @@ void initialize(byte factory_reset)
     EEPROM.get( ADDR_LIMIT2, g.limit2);
     EEPROM.get( ADDR_BACKLIGHT, g.backlight);
     get_reg();
+#ifdef SETTLE_MODEL
+    settle_coeffs c;
+    EEPROM.get( ADDR_SETTLE, c);
+    // EEPROM written by an older version of the firmware (the test is false for NaN):
+    if (!(c.t0 >= 0.0 && c.t0 < 100.0))
+      EEPROM.put( ADDR_SETTLE, SETTLE_DEFAULT);
+#endif
+#ifdef JOB_QUEUE
+    // The job queue, and its progress (an unfinished queue can be resumed with "*#"):
+    EEPROM.get( ADDR_JOB_N, g.job_n);
+    EEPROM.get( ADDR_JOB_I, g.job_i);
+    // EEPROM written by an older version of the firmware:
+    if (g.job_n > N_JOBS || g.job_i > g.job_n)
+    {
+      g.job_n = 0;
+      g.job_i = 0;
+    }
+#endif
+#ifdef FAST_STARTUP
+    // The rail state from the boot record, or the quick verify:
+    no_backlash_loop = boot_restore();
+#endif
   }
 
   // Five possible floating point values for acceleration
   set_accel_v();
+#ifdef INPUT_SHAPER
+  // Impulses of the input shaper for the current model:
+  shaper_init();
+#endif
 
   set_backlight();
 
@@ -111,7 +224,7 @@ void initialize(byte factory_reset)
   g.pos0 = g.pos;
   g.pos_old = g.pos;
   g.pos_short_old = floorMy(g.pos);
-  g.t0 = micros();
+  g.t0 = clock_us();
   g.t = g.t0;
   g.t_old = g.t0;
   g.t_key_pressed = g.t0;
@@ -127,6 +240,18 @@ void initialize(byte factory_reset)
   g.backlashing = 0;
   g.pos_stop_flag = 0;
   g.frame_counter = 0;
+#ifdef SETTLE_MODEL
+  // Until the first move (the rail could have been moved by hand):
+  g.pos_start = g.pos_short_old;
+  g.t_settle = first_delay();
+#endif
+#ifdef CAMERA_BUFFER
+  g.burst_frame = 32767;
+#endif
+#ifdef ENCODER
+  // The rail position read from EEPROM is the reference for the encoder:
+  encoder_sync();
+#endif
   g.coords_change = 0;
   g.start_stacking = 0;
   g.make_shot = 0;
@@ -140,6 +265,11 @@ void initialize(byte factory_reset)
     g.BL_counter = 0;
     g.backlash_init = 0;
   }
+#ifdef FAST_STARTUP
+  else if (no_backlash_loop)
+    // The backlash counter is known from the boot record (or the quick verify will take up the backlash):
+    g.backlash_init = 0;
+#endif
   else
   {
     // As we cannot be sure about the initial state of the rail, we are assuming the worst: a need for the maximum backlash compensation:
@@ -150,25 +280,32 @@ void initialize(byte factory_reset)
   g.dt_backlash = 0;
   g.continuous_mode = 1;
   g.noncont_flag = 0;
+  g.update_pending = 0;
+#ifdef JOB_QUEUE
+  g.job_mode = 0;
+  g.job_bank = 0;
+#endif
+#ifdef STOP_AND_GO
+  g.sng_flag = 0;
+#endif
+#ifdef SERPENTINE
+  g.reverse_pass = 0;
+#endif
   g.alt_flag = 0;
   g.disable_limiters = 0;
 #ifdef EXTENDED_REWIND
   g.no_extended_rewind = 0;
 #endif
+#ifdef IDLE_SLEEP
+  g.wakeup = 0;
+  g.t_sleep = 0;
+  g.t_duty0 = g.t0;
+  g.duty = 100;
+#endif
 
   g.msteps_per_frame = Msteps_per_frame();
   g.Nframes = Nframes();
 
-#ifdef TIMING
-  if (g.moving == 0)
-  {
-    g.i_timing = (unsigned long)0;
-    g.dt_max = (short)0;
-    g.dt_min = (short)10000;
-    g.bad_timing_counter = (short)0;
-  }
-#endif
-
 #ifdef MOTOR_DEBUG
   g.calibrate = 0;
   g.calibrate_warning = 0;
@@ -178,13 +315,9 @@ void initialize(byte factory_reset)
   // Default lcd layout:
   // This sets g.speed_limit, among other things:
   display_all();
-
-#ifdef CAMERA_DEBUG
-  shutter_status(0);
-  AF_status(0);
-  g.i_first_delay = 4;
-  g.i_second_delay = 3;
-#endif
+  // ... but not when the calibration warning is displayed (then the speed limit would stay zero, and calibration would never move):
+  if (g.calibrate_warning)
+    battery_status();
 
   return;
 }
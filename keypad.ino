@@ -53,7 +53,7 @@ void process_keypad()
   if (!keypad.getKeys() && !fake_key)
     return;
 
-  KeyState state0, state1;
+  KeyState state0, state1 = IDLE;
   char key0;
   bool state0_changed;
   if (fake_key)
@@ -102,6 +102,9 @@ void process_keypad()
           g.stacker_mode = 0;
           g.timelapse_mode = 0;
           g.end_of_stacking = 0;
+#ifdef JOB_QUEUE
+          job_abort();
+#endif
           display_all();
         }
         else
@@ -115,6 +118,20 @@ void process_keypad()
           g.calibrate_flag = 0;
           g.calibrate_warning = 0;
           g.calibrate_init = g.calibrate;
+#ifdef HOMING
+          g.homing_flag = 0;
+#endif
+#ifdef BL_MAP_DEBUG
+          g.bl_cal_flag = 0;
+#endif
+#ifdef FAST_STARTUP
+          g.boot_flag = 0;
+#endif
+#ifdef ACCEL_TUNE
+          if (g.tune_flag)
+            // The saved acceleration is restored once the rail stops:
+            g.tune_flag = 6;
+#endif
         }
         break;
 
@@ -207,7 +224,7 @@ void process_keypad()
         }
         // This 100 steps padding is just a hack, to fix the occasional bug when a combination of single frame steps and rewind can
         // move the rail beyond g.limit1
-        if (pos_target < g.limit1 + (COORD_TYPE)100 || pos_target > g.limit2 - (COORD_TYPE)100 || g.paused && (g.frame_counter < 0 || g.frame_counter >= g.Nframes))
+        if (pos_target < g.limit1 + (COORD_TYPE)100 || pos_target > g.limit2 - (COORD_TYPE)100 || (g.paused && (g.frame_counter < 0 || g.frame_counter >= g.Nframes)))
         {
           // Recovering the original frame counter if aborting:
           g.frame_counter = frame_counter0;
@@ -232,7 +249,7 @@ void process_keypad()
           g.frame_counter++;
           pos_target = (COORD_TYPE)(g.pos + g.msteps_per_frame);
         }
-        if (pos_target < g.limit1 + (COORD_TYPE)100 || pos_target > g.limit2 - (COORD_TYPE)100 || g.paused && (g.frame_counter < 0 || g.frame_counter >= g.Nframes))
+        if (pos_target < g.limit1 + (COORD_TYPE)100 || pos_target > g.limit2 - (COORD_TYPE)100 || (g.paused && (g.frame_counter < 0 || g.frame_counter >= g.Nframes)))
         {
           g.frame_counter = frame_counter0;
           break;
@@ -254,18 +271,33 @@ void process_keypad()
         // Checking the correctness of point1/2
         if (g.point2 > g.point1 && g.point1 >= g.limit1 && g.point2 <= g.limit2)
         {
+#ifdef JOB_QUEUE
+          if (g.job_mode == 1)
+          {
+            // Recording the job queue: adding a non-continuous job instead
+            job_add(0);
+            break;
+          }
+#endif
+#ifdef AXIS2
+          if (job_init() == 0)
+            break;
+#endif
           // Using the simplest approach which will result the last shot to always slightly undershoot
           g.Nframes = Nframes();
           // Always starting from the foreground point, for full backlash compensation:
           go_to((float)g.point1 + 0.5, g.speed_limit);
           g.starting_point = g.point1;
           g.destination_point = g.point2;
+#ifdef SERPENTINE
+          g.reverse_pass = 0;
+#endif
           g.stacker_mode = 1;
           // This is a non-continuous mode:
           g.continuous_mode = 0;
           g.start_stacking = 0;
           g.timelapse_counter = 0;
-          if (N_TIMELAPSE[g.i_n_timelapse] > 1)
+          if (n_timelapse() > 1)
             g.timelapse_mode = 1;
           display_comment_line("2-points stack");
         }
@@ -378,6 +410,45 @@ void process_keypad()
           EEPROM.put( ADDR_SAVE_ENERGY, g.save_energy);
           break;
 
+#ifdef CAMERA_BUFFER
+        case '#': // *#: Cycle through the camera models (burst buffer depth, burst and sustained frame rates)
+          if (g.i_camera < N_CAMERAS - 1)
+            g.i_camera++;
+          else
+            g.i_camera = 0;
+          EEPROM.put( ADDR_I_CAMERA, g.i_camera);
+          camera_buffer();
+          display_comment_line(g.buffer);
+          break;
+#endif
+
+#ifdef AXIS2
+        case '#': // *#: Change the number of lateral positions in the job mode
+          if (g.i_n_y < N_N_Y - 1)
+            g.i_n_y++;
+          else
+            g.i_n_y = 0;
+          EEPROM.put( ADDR_I_N_Y, g.i_n_y);
+          display_all();
+          break;
+#endif
+
+#ifdef JOB_QUEUE
+        case '#': // *#: Job queue: start recording; end recording and run the queue; resume an unfinished queue
+          job_key();
+          break;
+#endif
+
+#ifdef BL_MAP_DEBUG
+        case '#': // *#: Automatic backlash measurement at both limiters
+          if (g.calibrate || g.error)
+            break;
+          g.bl_cal_side = 1;
+          g.bl_cal_flag = 1;
+          display_comment_line("BL measurement");
+          break;
+#endif
+
       } // switch
     }
   }
@@ -400,9 +471,28 @@ void process_keypad()
             // Any key pressed when calibrate_warning=1 will initiate calibration:
           {
             g.calibrate_warning = 0;
+#ifdef ACCEL_TUNE
+            // "A" also tunes the acceleration, once the calibration (at the smallest acceleration) is done:
+            if (key0 == 'A' && g.tune_flag == 0)
+            {
+              g.i_accel_tune = 0;
+              set_accel_v();
+              g.tune_flag = 7;
+            }
+#endif
             display_all();
             return;
           }
+#ifdef BL_MAP_DEBUG
+          if (g.bl_cal_flag)
+            // Any key aborts the backlash measurement:
+          {
+            g.bl_cal_flag = 0;
+            change_speed(0.0, 0, 2);
+            display_comment_line("BL meas. abort");
+            return;
+          }
+#endif
         }
 
         // Keys interpretation depends on the stacker_mode:
@@ -416,7 +506,7 @@ void process_keypad()
           switch (key0)
           {
             case '1':  // 1: Rewinding, or moving 10 frames back for the current stacking direction (if paused)
-              if (g.pos_short_old <= g.limit1 && g.disable_limiters == 0 || g.paused > 1)
+              if ((g.pos_short_old <= g.limit1 && g.disable_limiters == 0) || g.paused > 1)
                 break;
               if (g.paused)
               {
@@ -425,7 +515,7 @@ void process_keypad()
                 frame_counter0 = g.frame_counter;
                 g.frame_counter = g.frame_counter - 10;
                 pos_target = frame_coordinate();
-                if (pos_target < g.limit1 + (COORD_TYPE)100 || pos_target > g.limit2 - (COORD_TYPE)100 || g.paused && (g.frame_counter < 0 || g.frame_counter >= g.Nframes))
+                if (pos_target < g.limit1 + (COORD_TYPE)100 || pos_target > g.limit2 - (COORD_TYPE)100 || (g.paused && (g.frame_counter < 0 || g.frame_counter >= g.Nframes)))
                 {
                   g.frame_counter = frame_counter0;
                   break;
@@ -448,7 +538,7 @@ void process_keypad()
               break;
 
             case 'A':  // A: Fast forwarding, or moving 10 frames forward for the current stacking direction (if paused)
-              if (g.pos_short_old >= g.limit2 && g.disable_limiters == 0 || g.paused > 1)
+              if ((g.pos_short_old >= g.limit2 && g.disable_limiters == 0) || g.paused > 1)
                 break;
               if (g.paused)
               {
@@ -457,7 +547,7 @@ void process_keypad()
                 frame_counter0 = g.frame_counter;
                 g.frame_counter = g.frame_counter + 10;
                 pos_target = frame_coordinate();
-                if (pos_target < g.limit1 + (COORD_TYPE)100 || pos_target > g.limit2 - (COORD_TYPE)100 || g.paused && (g.frame_counter < 0 || g.frame_counter >= g.Nframes))
+                if (pos_target < g.limit1 + (COORD_TYPE)100 || pos_target > g.limit2 - (COORD_TYPE)100 || (g.paused && (g.frame_counter < 0 || g.frame_counter >= g.Nframes)))
                 {
                   g.frame_counter = frame_counter0;
                   break;
@@ -549,7 +639,11 @@ void process_keypad()
                 else if (g.paused == 2)
                   // Restarting from a pause which happened during the initial travel to the starting point
                 {
+#ifdef SERPENTINE
+                  serpentine_start();
+#else
                   go_to((float)g.point1 + 0.5, g.speed_limit);
+#endif
                   g.stacker_mode = 1;
                   g.start_stacking = 0;
                   g.paused = 0;
@@ -558,16 +652,31 @@ void process_keypad()
                 else
                   // Initiating a new stack (or timelapse sequence of stacks)
                 {
+#ifdef JOB_QUEUE
+                  if (g.job_mode == 1)
+                  {
+                    // Recording the job queue: adding a continuous job instead
+                    job_add(1);
+                    break;
+                  }
+#endif
+#ifdef AXIS2
+                  if (job_init() == 0)
+                    break;
+#endif
                   // Using the simplest approach which will result the last shot to always slightly undershoot
                   g.Nframes = Nframes();
                   go_to((float)g.point1 + 0.5, g.speed_limit);
                   g.starting_point = g.point1;
                   g.destination_point = g.point2;
+#ifdef SERPENTINE
+                  g.reverse_pass = 0;
+#endif
                   g.stacker_mode = 1;
                   g.continuous_mode = 1;
                   g.start_stacking = 0;
                   g.timelapse_counter = 0;
-                  if (N_TIMELAPSE[g.i_n_timelapse] > 1)
+                  if (n_timelapse() > 1)
                     g.timelapse_mode = 1;
                   display_comment_line("2-points stack");
                 }
@@ -602,6 +711,9 @@ void process_keypad()
                 display_frame_counter();
                 g.pos_to_shoot = g.pos_short_old;
                 g.starting_point = g.pos_short_old;
+#ifdef SERPENTINE
+                g.reverse_pass = 0;
+#endif
                 g.stacker_mode = 3;
                 g.continuous_mode = 1;
                 display_comment_line("1-point stack ");
@@ -615,11 +727,24 @@ void process_keypad()
 #ifndef BL_DEBUG
 #ifndef BL2_DEBUG
 #ifndef DELAY_DEBUG
+#ifndef SETTLE_DEBUG
+#ifndef SHAPER_DEBUG
               if (g.i_n_shots > 0)
                 g.i_n_shots--;
               else
                 break;
               EEPROM.put( ADDR_I_N_SHOTS, g.i_n_shots);
+#else // SHAPER_DEBUG
+              // The meaning of "2" changes when SHAPER_DEBUG is defined: now it is used to select the previous input shaper model:
+              shaper_step(-1);
+              display_all();
+              display_shaper();
+              break;
+#endif // SHAPER_DEBUG
+#else // SETTLE_DEBUG
+              // The meaning of "2" changes when SETTLE_DEBUG is defined: now it is used to decrease the constant term of the settle time model:
+              settle_step(-SETTLE_STEP);
+#endif // SETTLE_DEBUG
 #else //DELAY_DEBUG
               // The meaning of "2" changes when DELAY_DEBUG is defined: now it is used to decrease the SHUTTER_ON_DELAY2 parameter:
               SHUTTER_ON_DELAY2 = SHUTTER_ON_DELAY2 - DELAY_STEP;
@@ -648,11 +773,24 @@ void process_keypad()
 #ifndef BL_DEBUG
 #ifndef BL2_DEBUG
 #ifndef DELAY_DEBUG
+#ifndef SETTLE_DEBUG
+#ifndef SHAPER_DEBUG
               if (g.i_n_shots < N_PARAMS - 1)
                 g.i_n_shots++;
               else
                 break;
               EEPROM.put( ADDR_I_N_SHOTS, g.i_n_shots);
+#else // SHAPER_DEBUG
+              // The meaning of "3" changes when SHAPER_DEBUG is defined: now it is used to select the next input shaper model:
+              shaper_step(1);
+              display_all();
+              display_shaper();
+              break;
+#endif // SHAPER_DEBUG
+#else // SETTLE_DEBUG
+              // The meaning of "3" changes when SETTLE_DEBUG is defined: now it is used to increase the constant term of the settle time model:
+              settle_step(SETTLE_STEP);
+#endif // SETTLE_DEBUG
 #else //DELAY_DEBUG
               // The meaning of "3" changes when DELAY_DEBUG is defined: now it is used to increase the SHUTTER_ON_DELAY2 parameter:
               SHUTTER_ON_DELAY2 = SHUTTER_ON_DELAY2 + DELAY_STEP;
@@ -740,7 +878,7 @@ void process_keypad()
                 // Estimating the required speed in microsteps per microsecond
                 speed = target_speed();
                 // Reverting back if required speed > maximum allowed:
-                if (speed > g.speed_limit || FPS[g.i_fps] > MAXIMUM_FPS)
+                if (speed > g.speed_limit || fps() > MAXIMUM_FPS)
                 {
                   g.i_fps--;
                   break;
@@ -826,7 +964,7 @@ void process_keypad()
             // Estimating how much rail would travel if the maximum breaking started now (that's how much
             // rail would actually travel if moving in the good direction, or if backlash was zero):
             // Stopping distance in the current direction:
-            float dx_stop = g.speed * g.speed / (2.0 * ACCEL_LIMIT);
+            float dx_stop = breaking_factor() * g.speed * g.speed;
             // The physical coordinate where we have to stop:
             float pos1 = g.pos - dx_stop;
             // To mimick the good direction (key "A") behaviour, we replace emergency breaking with a go_to call:
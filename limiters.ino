@@ -5,8 +5,39 @@ void limiters()
 {
   COORD_TYPE dx, dx_break;
 
+#ifdef LIMITER_INT
+  // Taking the limiter hit latched by the interrupt (if any); it is only valid for the current loop:
+  byte hit;
+  COORD_TYPE pos_hit;
+  noInterrupts();
+  hit = g.limit_hit;
+  pos_hit = g.limit_hit_pos;
+  g.limit_hit = 0;
+  interrupts();
+#endif
+
   if (g.moving == 0 || g.breaking == 1 || g.calibrate_flag == 5 || g.error > 0 || g.disable_limiters == 1)
     return;
+#ifdef HOMING
+  // Homing handles the limiter itself:
+  if (g.homing_flag > 0)
+    return;
+#endif
+#ifdef BL_MAP_DEBUG
+  // The backlash measurement handles the limiter itself:
+  if (g.bl_cal_flag >= 3 && g.bl_cal_flag <= 5)
+    return;
+#endif
+#ifdef FAST_STARTUP
+  // So does the quick verify (and the soft limits can't be trusted until it's done):
+  if (g.boot_flag > 1)
+    return;
+#endif
+#ifdef ACCEL_TUNE
+  // And the acceleration tuning, from the approach to the foreground limiter until the rail is back in the safe area:
+  if (g.tune_flag >= 2 && g.tune_flag <= 4)
+    return;
+#endif
 
   // If we are moving towards the second limiter (after hitting the first one), don't test for the limiter sensor until we moved DELTA_LIMITER beyond the point where we hit the first limiter:
   // This ensures that we don't accidently measure the original limiter as the second one.
@@ -19,6 +50,11 @@ void limiters()
 #else
   unsigned char limit_on = digitalRead(PIN_LIMITERS);
 #endif
+#ifdef LIMITER_INT
+  // The limiter could have bounced off by now:
+  if (hit)
+    limit_on = HIGH;
+#endif
 
   //////// Hard limits //////
   // If a limiter is on:
@@ -66,7 +102,13 @@ void limiters()
       g.calibrate_flag = 4;
     }
     // Memorizing the new limit for the current switch; this should be stored in EEPROM later, when moving=0
-    g.limit_tmp = g.pos_short_old;
+#ifdef LIMITER_INT
+    if (hit)
+      // The exact position where the limiter went on:
+      g.limit_tmp = pos_hit;
+    else
+#endif
+      g.limit_tmp = g.pos_short_old;
   }
   else
 
@@ -85,20 +127,37 @@ void limiters()
     {
       // Checking how far we are from a limiter in the direction we are moving
       // If current speed is non-zero, we use its sign to determine the direction we are moving to
+      // Preliminary test (for the highest speed of the current move; the trip points are precomputed in soft_limits()):
       if (g.speed < -SPEED_TINY || g.speed > SPEED_TINY)
       {
         if (g.speed < 0.0)
+        {
+          if (g.pos_short_old > g.soft_limit1)
+            return;
           dx = g.pos_short_old - g.limit1 - LIMITER_PAD2;
+        }
         else
+        {
+          if (g.pos_short_old < g.soft_limit2)
+            return;
           dx = g.limit2 - g.pos_short_old - LIMITER_PAD2;
+        }
       }
       else
         // Otherwise, we use the target direction sign, speed1:
       {
         if (g.speed1 < -SPEED_TINY)
+        {
+          if (g.pos_short_old > g.soft_limit1)
+            return;
           dx = g.pos_short_old - g.limit1 - LIMITER_PAD2;
+        }
         else if (g.speed1 > SPEED_TINY)
+        {
+          if (g.pos_short_old < g.soft_limit2)
+            return;
           dx = g.limit2 - g.pos_short_old - LIMITER_PAD2;
+        }
         else
           return;
       }
@@ -107,19 +166,20 @@ void limiters()
       if (dx < 0)
         return;
 
-      // Preliminary test (for highest possible speed):
-      if (dx <= roundMy(BREAKING_DISTANCE))
+      // Breaking distance at the current speed:
+      dx_break = roundMy(breaking_factor() * g.speed * g.speed);
+#ifdef INPUT_SHAPER
+      // The rail (shaped position) lags behind the commanded motion, which is what the breaking stops, by up to the shaper delay:
+      if (g.sh_n > 1)
+        dx_break += roundMy(fabs(g.speed) * (g.sh_n - 1) * g.sh_tau);
+#endif
+      // Accurate test (for the current speed):
+      if (dx <= dx_break)
+        // Emergency breaking, to avoid hitting the limiting switch
       {
-        // Breaking distance at the current speed:
-        dx_break = roundMy(0.5 * g.speed * g.speed / ACCEL_LIMIT);
-        // Accurate test (for the current speed):
-        if (dx <= dx_break)
-          // Emergency breaking, to avoid hitting the limiting switch
-        {
-          change_speed(0.0, 0, 2);
-          g.breaking = 1;
-          letter_status("B");
-        }
+        change_speed(0.0, 0, 2);
+        g.breaking = 1;
+        letter_status("B");
       }
     }
   }
@@ -128,3 +188,52 @@ void limiters()
 }
 
 
+void soft_limits()
+/* Precomputing the soft limit trip points for the current move (called every time the speed is changed in change_speed()).
+   Beyond g.soft_limit1 (moving backwards) or g.soft_limit2 (moving forward) the rail, moving at the highest speed of the move
+   (the larger of the current and target speeds), could no longer stop before getting within LIMITER_PAD2 of a limiter.
+   Before reaching the trip points, limiters() doesn't need to do any floating point calculations.
+ */
+{
+  float speed_max = fabs(g.speed);
+  if (fabs(g.speed1) > speed_max)
+    speed_max = fabs(g.speed1);
+
+  // Breaking distance at the highest speed:
+  COORD_TYPE dx_break = roundMy(breaking_factor() * speed_max * speed_max);
+#ifdef INPUT_SHAPER
+  // Plus the lag of the shaped position behind the commanded one:
+  if (g.sh_n > 1)
+    dx_break += roundMy(speed_max * (g.sh_n - 1) * g.sh_tau);
+#endif
+  g.soft_limit1 = g.limit1 + LIMITER_PAD2 + dx_break;
+  g.soft_limit2 = g.limit2 - LIMITER_PAD2 - dx_break;
+
+  return;
+}
+
+
+#ifdef LIMITER_INT
+ISR(PCINT0_vect)
+// Latching the rail position when the limiter goes on (the interrupt fires on both edges; only the first rising edge per loop is used)
+{
+  if (g.moving && g.limit_hit == 0 && (PINB & _BV(PINB0)))
+  {
+    g.limit_hit_pos = g.pos_short_old;
+    g.limit_hit = 1;
+  }
+#ifdef FLASH_SYNC
+  // The flash sync pin (9) is on the same port:
+  flash_latch();
+#endif
+#ifdef ENCODER
+  // So is the encoder channel A (9):
+  encoder_count();
+#endif
+#ifdef IDLE_SLEEP
+  // Also a keypad row pin (12) during the idle sleep:
+  g.wakeup = 1;
+#endif
+}
+#endif
+
@@ -1,7 +1,74 @@
 float target_speed ()
 // Estimating the required speed in microsteps per microsecond
 {
-  return SPEED_SCALE * FPS[g.i_fps] * MM_PER_FRAME[g.i_mm_per_frame];
+  return SPEED_SCALE * fps() * mm_per_frame();
+}
+
+
+#ifdef CAMERA_BUFFER
+float camera_fps (byte sustained)
+/* Frame rate for continuous stacking: fps(), limited by the burst (sustained=0) or the sustained (sustained=1) frame rate of the camera model.
+ */
+{
+  float f;
+  if (sustained)
+    f = pgm_read_float(&CAMERAS[g.i_camera].sustained_fps);
+  else
+    f = pgm_read_float(&CAMERAS[g.i_camera].burst_fps);
+  if (f > 0.0 && f < fps())
+    return f;
+  else
+    return fps();
+}
+
+
+short burst_frames ()
+/* Number of frames the camera can shoot at camera_fps(0), starting with an empty buffer, before the buffer is full
+   (the buffer is written to the card at camera_fps(1) all along). 32767 if there is no limit.
+ */
+{
+  byte buffer = pgm_read_byte(&CAMERAS[g.i_camera].buffer);
+  float f1 = camera_fps(0);
+  float f2 = camera_fps(1);
+  if (buffer == 0 || f2 >= f1)
+    return 32767;
+  return (short)((float)buffer / (1.0 - f2 / f1));
+}
+
+
+short burst_plan ()
+/* Planning a continuous stack which starts (or resumes) now, with an empty camera buffer. Returns the frame counter value at which the rail
+   has to start slowing down from the burst to the sustained speed, so that it's done before the buffer is full; 32767 if never.
+   The stack time is the shortest possible, as the slowdown starts as late as possible.
+ */
+{
+  short n = burst_frames();
+  if (n == 32767)
+    return n;
+  float v1 = SPEED_SCALE * camera_fps(0) * mm_per_frame();
+  float v2 = SPEED_SCALE * camera_fps(1) * mm_per_frame();
+  // Frames passed while decelerating (go_to() always decelerates with accel_limit()):
+  short n_dec = (short)(breaking_factor() * (v1 * v1 - v2 * v2) / g.msteps_per_frame) + 1;
+  if (n <= n_dec)
+    // Sustained speed from the start:
+    return g.frame_counter;
+  return g.frame_counter + n - n_dec;
+}
+#endif
+
+
+float stack_time (short n)
+/* Time (s) needed to shoot n frames in continuous stacking (with the camera buffer model, the rail deceleration is not included).
+ */
+{
+#ifndef CAMERA_BUFFER
+  return (float)(n - 1) / fps();
+#else
+  short k = burst_frames();
+  if (n - 1 <= k)
+    return (float)(n - 1) / camera_fps(0);
+  return (float)k / camera_fps(0) + (float)(n - 1 - k) / camera_fps(1);
+#endif
 }
 
 
@@ -9,9 +76,73 @@ float Msteps_per_frame ()
 /* Computing the "microsteps per frame" parameter - redo this every time g.i_mm_per_frame changes.
  */
 {
-  return (MM_PER_FRAME[g.i_mm_per_frame] / MM_PER_ROTATION) * MICROSTEPS_PER_ROTATION;
+  return (mm_per_frame() / MM_PER_ROTATION) * MICROSTEPS_PER_ROTATION;
+}
+
+
+//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Current values of the input parameters (the tables are stored in flash memory):
+float mm_per_frame ()
+{
+  return pgm_read_float(&MM_PER_FRAME[g.i_mm_per_frame]);
+}
+
+float fps ()
+{
+  return pgm_read_float(&FPS[g.i_fps]);
+}
+
+short n_shots ()
+{
+  return pgm_read_word(&N_SHOTS[g.i_n_shots]);
 }
 
+float first_delay ()
+{
+  return pgm_read_float(&FIRST_DELAY[g.i_first_delay]);
+}
+
+float second_delay ()
+{
+  return pgm_read_float(&SECOND_DELAY[g.i_second_delay]);
+}
+
+byte accel_factor ()
+{
+  return pgm_read_byte(&ACCEL_FACTOR[g.i_accel_factor]);
+}
+
+float accel_limit ()
+// The largest acceleration (microsteps/us^2): ACCEL_LIMIT, or the one tuned for the payload (ACCEL_TUNE)
+{
+#ifdef ACCEL_TUNE
+  return g.accel_limit;
+#else
+  return ACCEL_LIMIT;
+#endif
+}
+
+float breaking_factor ()
+// Breaking distance (microsteps) at the largest deceleration is breaking_factor() * speed^2
+{
+#ifdef ACCEL_TUNE
+  return g.breaking_factor;
+#else
+  return BREAKING_FACTOR;
+#endif
+}
+
+short n_timelapse ()
+{
+  return pgm_read_word(&N_TIMELAPSE[g.i_n_timelapse]);
+}
+
+short dt_timelapse ()
+{
+  return pgm_read_word(&DT_TIMELAPSE[g.i_dt_timelapse]);
+}
+//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
 
 short Nframes ()
 /* Computing the "Nframes" parameter (only for 2-point stacking) - redo this every time either of
@@ -34,7 +165,7 @@ char *ftoa(char *a, float f, int precision)
   *a++ = '.';
   long desimal = abs((long)((f - heiltal) * p[precision]));
   // Filling up with leading zeros if needed:
-  for (byte i = snprintf(0, 0, "%+d", desimal) - 1; i < precision; i++)
+  for (byte i = snprintf(0, 0, "%+ld", desimal) - 1; i < precision; i++)
     *a++ = '0';
   itoa(desimal, a, 10);
   return ret;
@@ -129,24 +260,33 @@ void change_speed(float speed1_loc, byte moving_mode1, char accel)
     g.t0 = g.t;
     g.speed0 = g.speed;
     g.pos0 = g.pos;
+#ifdef INPUT_SHAPER
+    if (g.moving && g.sh_n > 1)
+      shaper_push();
+#endif
   }
 
   if (g.accel != 0 && g.moving == 0 && g.started_moving == 0)
   {
     // Starting moving
     g.started_moving = 1;
+#ifdef SETTLE_MODEL
+    g.pos_start = g.pos_short_old;
+#endif
     motion_status();
-    if (g.save_energy)
-    {
-#ifndef DISABLE_MOTOR
-      digitalWrite(PIN_ENABLE, LOW);
+#ifdef FAST_STARTUP
+    boot_dirty();
 #endif
-      delay(ENABLE_DELAY_MS);
-    }
+    // The motion starts once the driver is ready (motor_control()):
+    if (g.save_energy)
+      driver_enable();
   }
 
   // Updating the target speed:
   g.speed1 = speed1_loc;
+
+  // New soft limit trip points for the modified move:
+  soft_limits();
   return;
 }
 //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -174,12 +314,16 @@ void go_to(float pos1, float speed)
   if (g.breaking || g.backlashing)
     return;
 
+#ifdef BL_MAP
+  // The backlash to compensate is the one at the target position:
+  update_local_backlash(pos1);
+#endif
+
   // Ultimate physical coordinate to achieve:
   COORD_TYPE pos1_short = floorMy(pos1);
 
   // Current physical coordinate:
   COORD_TYPE pos_short_phys = g.pos_short_old + g.BL_counter;
-  float pos_phys = g.pos + (float)g.BL_counter;
 
   // We are already there, and no need for backlash compensation, so just returning:
   if (g.moving == 0 && pos1_short == g.pos_short_old && g.BL_counter == (COORD_TYPE)0)
@@ -218,18 +362,16 @@ void go_to(float pos1, float speed)
   {
     // Stopping distance in the current direction:
     // Breaking is always done with the maximum deceleration:
-    float dx_stop = g.speed * g.speed / (2.0 * ACCEL_LIMIT);
+    float dx_stop = breaking_factor() * g.speed * g.speed;
     // Travel vector:
     float dx_vec = pos1 - g.pos;
     float dx = fabs(dx_vec);
-    // Number of whole steps to take if going straight to the target:
-    COORD_TYPE dx_steps = pos1_short - g.pos_short_old;
 
     // All the cases when speed sign will change while traveling to the target:
     // When we move in the correct direction, but cannot stop in time because of the acceleration limit
-    if (dx < dx_stop && (g.direction > 0 && g.speed > 0.0 || g.direction < 0 && g.speed <= 0.0) ||
+    if ((dx < dx_stop && ((g.direction > 0 && g.speed > 0.0) || (g.direction < 0 && g.speed <= 0.0))) ||
         // or when we are moving in the wrong direction
-        g.direction > 0 && g.speed <= 0.0 || g.direction < 0 && g.speed > 0.0)
+        (g.direction > 0 && g.speed <= 0.0) || (g.direction < 0 && g.speed > 0.0))
       speed_changes = 1;
     else
       // In all other cases speed sign will be constant:
@@ -239,11 +381,11 @@ void go_to(float pos1, float speed)
     // (The second goto is initiated in backlash() )
     if (
       // Case 1: Moving towards the target, in the bad (negative) direction:
-      g.speed <= 0.0 && !speed_changes ||
+      (g.speed <= 0.0 && !speed_changes) ||
       // Case 2: Moving in the bad direction, will have to reverse the direction to the good one, but at the end not enough to compensate for BL:
-      g.speed <= 0.0 && speed_changes && floorMy(dx_stop - dx) < g.backlash ||
+      (g.speed <= 0.0 && speed_changes && floorMy(dx_stop - dx) < g.backlash) ||
       // Case 3: Initially moving in the good direction, but reverse at the end, so BL compensation is needed:
-      g.speed > 0.0 && speed_changes)
+      (g.speed > 0.0 && speed_changes))
     {
       // Current target position (to be achieved in the current go_to call):
       pos1 = pos1 - (float)g.backlash;
@@ -276,24 +418,24 @@ void stop_now()
  Things to do when we decide to stop inside motor_control().
  */
 {
-#ifdef TIMING
+#ifdef TELEMETRY
   // Update timing stats for the very last loop in motion (before setting g.moving=0):
   timing();
 #endif
 
+#ifdef MICROSTEP_SWITCH
+  // Back to microsteps (catching up with the current position) before stopping:
+  if (g.ms_coarse)
+    set_fine_steps();
+#endif
+
   g.moving = 0;
   g.t_old = g.t;
   g.pos_old = g.pos;
   g.pos_short_old = floorMy(g.pos);
-
-#ifdef TIMING
-  // Displaying the timing data from the last movement:
-  display_current_position();
-  delay(5000);
-  g.i_timing = (unsigned long)0;
-  g.dt_max = (short)0;
-  g.dt_min = (short)10000;
-  g.bad_timing_counter = (short)0;
+#ifdef TELEMETRY
+  // The first loop of the next move will be skipped in timing():
+  g.i_timing = 0;
 #endif
 
   if (g.error == 1)
@@ -304,17 +446,24 @@ void stop_now()
       g.error = 0;
   }
 
-  if (g.save_energy)
-  {
-#ifndef DISABLE_MOTOR
-    digitalWrite(PIN_ENABLE, HIGH);
+  // Saving the position, refreshing the display and the coordinate recalibration are left for later (deferred_updates()), so they don't delay
+  // the next move (the backlash compensation leg, the next frame in non-continuous stacking); the driver is disabled later as well (driver_idle()):
+  g.update_pending = 1;
+#ifdef SETTLE_MODEL
+  // Before g.backlashing is reset:
+  settle_time();
+#endif
+#ifdef ENCODER
+  // The position will be verified once the rail is at rest (after the backlash compensation leg, if any), unless the motor stalled:
+  if (g.enc_flag == 0)
+    g.enc_flag = 1;
 #endif
-    delay(ENABLE_DELAY_MS);
-  }
-
-  // Saving the current position to EEPROM:
-  EEPROM.put( ADDR_POS, g.pos );
 
+#ifdef HOMING
+  // The stops during homing are not calibration legs:
+  if (g.homing_flag == 0)
+  {
+#endif
   if (g.calibrate_flag == 5)
     // At this point any calibration should be done (we are in a safe zone, after calibrating both limiters):
   {
@@ -322,6 +471,9 @@ void stop_now()
     g.calibrate_init = 0;
 
     EEPROM.put( ADDR_CALIBRATE, 0 );
+#ifdef HOMING
+    g.homing_report = 1;
+#endif
   }
 
   if (g.calibrate_flag == 4)
@@ -329,6 +481,9 @@ void stop_now()
 
   if ((g.calibrate == 1 || g.calibrate == 2) && g.calibrate_flag == 1)
     g.calibrate_warning = 1;
+#ifdef HOMING
+  }
+#endif
 
   // In the initial calibration, disable the warning flag after the first leg:
   if (g.calibrate_init == 3 && g.calibrate_warning == 1)
@@ -348,21 +503,18 @@ void stop_now()
   g.breaking = 0;
   g.backlashing = 0;
   g.speed = 0.0;
-  // Refresh the whole display:
-  display_all();
-  if (g.noncont_flag > 0)
+#ifdef HOMING
+  if (g.homing_report)
+    // Repeatability of the two limiters, measured during the calibration:
   {
-    letter_status("S");
+    // (up to 999 microsteps, to fit the comment line)
+    sprintf(g.buffer, "Rep F%3d B%3d ", (int)constrain(g.homing_rep[0], 0, 999), (int)constrain(g.homing_rep[1], 0, 999));
+    display_comment_line(g.buffer);
+    g.homing_report = 0;
   }
+#endif
   g.t_display = g.t;
 
-  if (g.calibrate_flag == 0 && g.coords_change != 0)
-    // We apply the coordinate change after doing calibration:
-  {
-    coordinate_recalibration();
-    g.coords_change = 0;
-  }
-
   // Used in continuous_mode=0; we are here right after the travel to the next frame position
   if (g.noncont_flag == 4)
     g.noncont_flag = 1;
@@ -380,9 +532,102 @@ void stop_now()
 //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
 
+void deferred_updates()
+/* Saving the position, refreshing the display and the coordinate recalibration, deferred by stop_now(). Only done when the rail is at rest (so
+   after the backlash compensation leg, if any) and the camera is not being triggered, and in non-continuous stacking not while the shot at the
+   new frame is pending or due within UPDATE_TIME.
+ */
+{
+  if (g.update_pending == 0 || g.moving || g.started_moving || g.make_shot || g.shutter_on)
+    return;
+  if (g.stacker_mode == 2)
+  {
+    // The shot at the new frame goes first:
+    if (g.noncont_flag == 1)
+      return;
+#ifdef SETTLE_MODEL
+    float delay1 = settle_delay();
+#else
+    float delay1 = first_delay();
+#endif
+    if (g.noncont_flag == 2 && (float)(g.t - g.t_shot + UPDATE_TIME) > delay1 * 1e6)
+      return;
+  }
+
+  g.update_pending = 0;
+  if (g.calibrate_flag == 0 && g.coords_change != 0)
+    // We apply the coordinate change after doing calibration:
+  {
+    coordinate_recalibration();
+    g.coords_change = 0;
+  }
+  EEPROM.put( ADDR_POS, g.pos );
+#ifdef FAST_STARTUP
+  // The rail state for the next power-up:
+  boot_save();
+#endif
+  display_all();
+  if (g.noncont_flag > 0)
+    letter_status("S");
+  g.t_display = g.t;
+  return;
+}
+
+
+#ifdef SETTLE_MODEL
+void settle_time()
+/* Called when the rail stops: computing the time needed for the rail vibrations to settle after this move (g.t_settle, s).
+ */
+{
+  settle_coeffs c;
+  EEPROM.get( ADDR_SETTLE, c);
+  float d = fabs((float)(g.pos_short_old - g.pos_start));
+  // go_to() moves start from rest and decelerate at accel_limit(), so the peak speed (microsteps/us) follows from the length:
+  float v = sqrt(accel_limit() * d);
+  if (v > g.speed_limit)
+    v = g.speed_limit;
+  g.t_settle = c.t0 + c.k_d * MM_PER_MICROSTEP * d + c.k_v * v / SPEED_SCALE;
+  if (g.backlashing)
+    g.t_settle = g.t_settle + c.t_bl;
+  if (g.mirror_lock == 1 && g.t_settle < c.t_mirror)
+    g.t_settle = c.t_mirror;
+  return;
+}
+
+
+#ifdef SETTLE_DEBUG
+void settle_step(float dt)
+/* Changing the constant term of the settle time model by dt (s), and saving it in EEPROM.
+ */
+{
+  settle_coeffs c;
+  EEPROM.get( ADDR_SETTLE, c);
+  c.t0 = c.t0 + dt;
+  if (c.t0 < 0.0)
+    c.t0 = 0.0;
+  if (c.t0 > 10.0)
+    c.t0 = 10.0;
+  EEPROM.put( ADDR_SETTLE, c);
+  return;
+}
+#endif
+
+
+float settle_delay()
+/* The delay (s) between the end of the move and the shot in non-continuous stacking: the settle time of the last move, but not longer than FIRST_DELAY.
+ */
+{
+  return min(g.t_settle, first_delay());
+}
+#endif
+//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+
 void set_backlight()
 // Setting the LCD backlight. 2 levels for now.
 {
+#if !defined(AXIS2) && !defined(FLASH_SYNC) && !defined(ENCODER)
+  // (With AXIS2, FLASH_SYNC or ENCODER, the backlight pin is used for something else)
   switch (g.backlight)
   {
     case 0:
@@ -399,6 +644,7 @@ void set_backlight()
       //      analogWrite(PIN_LCD_LED, 255);
       //      break;
   }
+#endif
 
   EEPROM.put( ADDR_BACKLIGHT, g.backlight);
 
@@ -418,6 +664,9 @@ void coordinate_recalibration()
 
   g.pos = g.pos + (float)g.coords_change;
   g.pos_short_old = g.pos_short_old + g.coords_change;
+#ifdef ENCODER
+  g.enc_offset = g.enc_offset + g.coords_change;
+#endif
   g.t0 = g.t;
   g.pos0 = g.pos;
   // Updating g.limit2 (g.limit1-limit1_old is the difference between the new and old coordinates):
@@ -436,12 +685,17 @@ void coordinate_recalibration()
 
 void set_accel_v()
 {
+#ifdef ACCEL_TUNE
+  // The acceleration tuned for the payload:
+  g.accel_limit = 0.25 * ACCEL_LIMIT * (float)pgm_read_byte(&TUNED_ACCEL[g.i_accel_tune]);
+  g.breaking_factor = 0.5 / g.accel_limit;
+#endif
   // Five possible floating point values for acceleration
-  g.accel_v[0] = -ACCEL_LIMIT;
-  g.accel_v[1] = -ACCEL_LIMIT / (float)ACCEL_FACTOR[g.i_accel_factor];
+  g.accel_v[0] = -accel_limit();
+  g.accel_v[1] = -accel_limit() / (float)accel_factor();
   g.accel_v[2] = 0.0;
-  g.accel_v[3] =  ACCEL_LIMIT / (float)ACCEL_FACTOR[g.i_accel_factor];
-  g.accel_v[4] =  ACCEL_LIMIT;
+  g.accel_v[3] =  accel_limit() / (float)accel_factor();
+  g.accel_v[4] =  accel_limit();
   return;
 }
 
@@ -496,6 +750,15 @@ void put_reg()
   EEPROM.put( ADDR_SAVE_ENERGY, g.save_energy);
   EEPROM.put( ADDR_POINT1, g.point1);
   EEPROM.put( ADDR_POINT2, g.point2);
+#ifdef CAMERA_BUFFER
+  EEPROM.put( ADDR_I_CAMERA, g.i_camera);
+#endif
+#ifdef INPUT_SHAPER
+  EEPROM.put( ADDR_I_SHAPER, g.i_shaper);
+#endif
+#ifdef ACCEL_TUNE
+  EEPROM.put( ADDR_I_ACCEL_TUNE, g.i_accel_tune);
+#endif
   return;
 }
 
@@ -519,6 +782,24 @@ void get_reg()
   update_save_energy();
   EEPROM.get( ADDR_POINT1, g.point1);
   EEPROM.get( ADDR_POINT2, g.point2);
+#ifdef CAMERA_BUFFER
+  EEPROM.get( ADDR_I_CAMERA, g.i_camera);
+  // EEPROM written by an older version of the firmware:
+  if (g.i_camera >= N_CAMERAS)
+    g.i_camera = 0;
+#endif
+#ifdef INPUT_SHAPER
+  EEPROM.get( ADDR_I_SHAPER, g.i_shaper);
+  // EEPROM written by an older version of the firmware:
+  if (g.i_shaper >= N_SHAPERS)
+    g.i_shaper = 0;
+#endif
+#ifdef ACCEL_TUNE
+  EEPROM.get( ADDR_I_ACCEL_TUNE, g.i_accel_tune);
+  // EEPROM written by an older version of the firmware:
+  if (g.i_accel_tune >= N_TUNED_ACCEL)
+    g.i_accel_tune = ACCEL_TUNE_DEFAULT;
+#endif
   return;
 }
 
@@ -530,6 +811,10 @@ void rail_reverse(byte fix_points)
 {
   COORD_TYPE d_pos, pos_target;
 
+#ifdef BL_MAP
+  // Local backlash at the current rail position (g.straight has already been changed, so using the reversed coordinate):
+  update_local_backlash((float)(g.limit1 + g.limit2) - g.pos);
+#endif
   // We need to do a full backlash compensation loop when reversing the rail operation:
   g.BL_counter = g.backlash;
   // This will instruct the backlash module to do BACKLASH_2 travel at the end, to compensate for BL in reveresed coordinates
@@ -549,6 +834,10 @@ void rail_reverse(byte fix_points)
   g.pos0 = g.pos;
   g.pos_old = g.pos;
   g.pos_short_old = floorMy(g.pos);
+#ifdef ENCODER
+  // The encoder counts in the opposite direction now (g.straight has already been changed):
+  g.enc_offset = d_pos - g.enc_offset;
+#endif
   if (fix_points)
   {
     // Updating the current two points positions:
@@ -566,17 +855,80 @@ void rail_reverse(byte fix_points)
 COORD_TYPE frame_coordinate()
 // Coordinate (COORD_TYPE type) of a frame given by g.frame_number, in 2-point stacking
 {
+#ifdef SERPENTINE
+  if (g.reverse_pass)
+    // The frames of the forward stack, in the reverse order:
+    return g.starting_point + nintMy(((float)(g.Nframes - 1 - g.frame_counter)) * g.msteps_per_frame);
+#endif
   return g.starting_point + nintMy(((float)g.frame_counter) * g.msteps_per_frame);
 }
 
 
+#ifdef SERPENTINE
+COORD_TYPE shot_coordinate()
+/* Rail coordinate at which the frame given by g.frame_counter is shot. In a backward stack the rail moves in the bad direction with the backlash
+   taken up (g.BL_counter = g.backlash), so the physical coordinate is g.backlash larger than the rail one (pos_phys = pos_prog + g.BL_counter).
+ */
+{
+  if (g.reverse_pass)
+    return frame_coordinate() - g.backlash;
+  return frame_coordinate();
+}
+
+
+void serpentine_start()
+/* Initiating the travel to the start of the current stack of a timelapse sequence (given by g.timelapse_counter): the odd ones are shot backwards
+   in continuous mode. (Non-continuous stacks are always shot forward: backwards, every frame would need a backlash compensation loop, which
+   costs much more than the rewind.)
+ */
+{
+  g.reverse_pass = (g.timelapse_counter & 1) && g.continuous_mode;
+  g.frame_counter = 0;
+  if (g.reverse_pass)
+  {
+    // Starting from point2 (where the forward stack ended), so the backlash is taken up before the first frame. The travel ends one microstep
+    // beyond point1, so the last frame is shot before the rail stops (and the backlash compensation leg starts):
+    g.destination_point = g.point1 - 1;
+    go_to((float)g.point2 + 0.5, g.speed_limit);
+  }
+  else
+  {
+    g.destination_point = g.point2;
+    go_to((float)g.point1 + 0.5, g.speed_limit);
+  }
+  return;
+}
+#endif
+
+
 
 void read_params(const int addr, byte n)
 {
   byte straight_old = g.straight;
   EEPROM.get( addr, g.reg);
   from_reg();
+#ifdef CAMERA_BUFFER
+  EEPROM.get( ADDR_I_CAMERA_REG + n - 1, g.i_camera);
+  if (g.i_camera >= N_CAMERAS)
+    g.i_camera = 0;
+#endif
+#ifdef INPUT_SHAPER
+  EEPROM.get( ADDR_I_SHAPER_REG + n - 1, g.i_shaper);
+  if (g.i_shaper >= N_SHAPERS)
+    g.i_shaper = 0;
+  shaper_init();
+#endif
+#ifdef ACCEL_TUNE
+  EEPROM.get( ADDR_I_ACCEL_TUNE_REG + n - 1, g.i_accel_tune);
+  if (g.i_accel_tune >= N_TUNED_ACCEL)
+    g.i_accel_tune = ACCEL_TUNE_DEFAULT;
+  // The payload of the bank (and its accel_factor):
+  set_accel_v();
+#endif
   put_reg();
+#ifdef JOB_QUEUE
+  g.job_bank = n;
+#endif
   g.msteps_per_frame = Msteps_per_frame();
   g.Nframes = Nframes();
   display_all();
@@ -597,6 +949,18 @@ void save_params(const int addr, byte n)
 {
   to_reg();
   EEPROM.put( addr, g.reg);
+#ifdef CAMERA_BUFFER
+  EEPROM.put( ADDR_I_CAMERA_REG + n - 1, g.i_camera);
+#endif
+#ifdef INPUT_SHAPER
+  EEPROM.put( ADDR_I_SHAPER_REG + n - 1, g.i_shaper);
+#endif
+#ifdef ACCEL_TUNE
+  EEPROM.put( ADDR_I_ACCEL_TUNE_REG + n - 1, g.i_accel_tune);
+#endif
+#ifdef JOB_QUEUE
+  g.job_bank = n;
+#endif
   display_comment_line("Saved to Reg");
   lcd.print(n);
   lcd.clearRestOfLine();
@@ -609,7 +973,11 @@ void update_backlash()
 {
   if (g.backlash_on)
   {
+#ifdef BL_MAP
+    g.backlash = local_backlash(g.pos);
+#else
     g.backlash = BACKLASH;
+#endif
     g.BL_counter = g.backlash;
     g.backlash_init = 1;
   }
@@ -622,14 +990,66 @@ void update_backlash()
 void update_save_energy()
 // Call it every time g.save_energy is changed
 {
-#ifdef DISABLE_MOTOR
-  return;
-#else
   if (g.save_energy)
-    digitalWrite(PIN_ENABLE, HIGH); // Not using the holding torque feature (to save batteries)
+  {
+    // Not using the holding torque feature (to save batteries); while moving, the driver is disabled once the rail stops (driver_idle()):
+    if (g.moving == 0 && g.started_moving == 0)
+      driver_disable();
+  }
   else
-    digitalWrite(PIN_ENABLE, LOW); // Using the holding torque feature (bad for batteries; good for holding torque and accuracy)
+    driver_enable(); // Using the holding torque feature (bad for batteries; good for holding torque and accuracy)
   return;
+}
+
+
+void driver_enable()
+/* Enabling the motor driver (if it is disabled). It is ready ENABLE_DELAY_MS later (see driver_ready()); nothing waits here.
+ */
+{
+  if (g.driver_state > 0)
+    return;
+#ifndef DISABLE_MOTOR
+  digitalWrite(PIN_ENABLE, LOW);
+#endif
+  g.driver_state = 1;
+  g.t_enable = clock_us();
+  return;
+}
+
+
+void driver_disable()
+{
+#ifndef DISABLE_MOTOR
+  digitalWrite(PIN_ENABLE, HIGH);
+#endif
+  g.driver_state = 0;
+  return;
+}
+
+
+byte driver_ready()
+/* 1 if the driver can take steps (called from motor_control() when a move starts; g.t is the current time).
+ */
+{
+  if (g.driver_state == 1 && g.t - g.t_enable >= 1000UL * ENABLE_DELAY_MS)
+    g.driver_state = 2;
+  return g.driver_state == 2;
+}
+
+
+void driver_idle()
+/* Disabling the driver in the save energy mode, in the first loop when the rail is at rest and no new move was initiated (so a move which starts
+   right after a stop, e.g. the backlash compensation leg, doesn't wait for the driver). Called from loop() before motor_control().
+ */
+{
+  if (g.save_energy == 0 || g.driver_state == 0 || g.moving || g.started_moving
+#ifdef AXIS2
+      // The driver enable pin is shared with the lateral motor:
+      || g.y_moving
 #endif
+     )
+    return;
+  driver_disable();
+  return;
 }
 
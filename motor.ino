@@ -5,7 +5,7 @@ void motor_control()
    Important: g.moving can be set to zero only here (by calling stop_now())! Also, it should be set to 1 only outside of this function.
  */
 {
-  unsigned long dt, dt_a;
+  unsigned long dt, dt_a = 0;
   float dV;
   char new_accel;
   byte instant_stop, i_case;
@@ -14,9 +14,9 @@ void motor_control()
   // Current time in microseconds:
 #ifdef PRECISE_STEPPING
   // Moving the motor timer back in time if skipped steps were detected in this travel:
-  g.t = micros() - g.dt_backlash;
+  g.t = clock_us() - g.dt_backlash;
 #else
-  g.t = micros();
+  g.t = clock_us();
 #endif
 
   // If we initiated a movement elsewhere (by setting started_moving=1), we should only update g.t0 here. Meaning
@@ -24,9 +24,15 @@ void motor_control()
   // SAVE_ENERGY).
   if (g.started_moving == 1)
   {
+    // Waiting for the driver to get ready (it was just enabled):
+    if (driver_ready() == 0)
+      return;
     g.started_moving = 0;
     g.moving = 1;
     g.t0 = g.t;
+#ifdef INPUT_SHAPER
+    shaper_start();
+#endif
     // We skip this loop, as no point solving the equation of motion for the t=t0 point (dt=0)
     return;
   }
@@ -35,6 +41,12 @@ void motor_control()
   if (g.moving == 0)
     return;
 
+#ifdef LIMITER_INT
+  // The limiter went on after limiters() was called in this loop; starting emergency breaking before making any more steps:
+  if (g.limit_hit)
+    limiters();
+#endif
+
 
   ////////   PART 1: estimating the current position, pos (solving the equation of motion)
 
@@ -71,7 +83,13 @@ void motor_control()
       {
         // At this point we stopped, so no need to revisit the motor_control module
         instant_stop = 1;
-        stop_now();
+#ifdef INPUT_SHAPER
+        if (g.sh_n > 1)
+          // (the rail is still catching up with the commanded motion)
+          shaper_stop();
+        else
+#endif
+          stop_now();
       }
     }
     else
@@ -91,18 +109,26 @@ void motor_control()
   //////////  PART 2: Estimating if we need to make a step, and making the step if needed
 
 
+  // Position and speed of the motor:
+  float pos_m = g.pos;
+  float speed_m = g.speed;
+#ifdef INPUT_SHAPER
+  if (g.sh_n > 1)
+    pos_m = shaper_pos(&speed_m);
+#endif
+
   // Integer position (in microsteps):
-  COORD_TYPE pos_short = floorMy(g.pos);
+  COORD_TYPE pos_short = floorMy(pos_m);
 
   // If speed changed the sign since the last step, change motor direction:
-  if (g.speed > 0.0 && g.speed_old <= 0.0)
+  if (speed_m > 0.0 && g.speed_old <= 0.0)
   {
 #ifndef DISABLE_MOTOR  
     digitalWrite(PIN_DIR, g.straight);
 #endif    
     delayMicroseconds(STEP_LOW_DT);
   }
-  else if (g.speed < 0.0 && g.speed_old >= 0.0)
+  else if (speed_m < 0.0 && g.speed_old >= 0.0)
   {
 #ifndef DISABLE_MOTOR  
     digitalWrite(PIN_DIR, 1-g.straight);
@@ -110,6 +136,21 @@ void motor_control()
     delayMicroseconds(STEP_LOW_DT);
   }
 
+#ifdef MICROSTEP_SWITCH
+  // Switching between full steps (fast travel) and microsteps:
+  microstep_switch();
+  if (g.ms_coarse)
+  {
+    // Only whole full steps are made (pos_short_old stays at full step positions, and lags behind g.pos by less than a full step):
+    pos_short = g.pos_short_old + N_MICROSTEPS * ((pos_short - g.pos_short_old) / N_MICROSTEPS);
+    // One full step per call at most; after a slow loop the motor catches up in the next loops (as with the shaped motion below):
+    if (pos_short > g.pos_short_old + N_MICROSTEPS)
+      pos_short = g.pos_short_old + N_MICROSTEPS;
+    else if (pos_short < g.pos_short_old - N_MICROSTEPS)
+      pos_short = g.pos_short_old - N_MICROSTEPS;
+  }
+#endif
+
   // If the pos_short changed since the last step, do another step
   // This implicitely assumes that Arduino loop is shorter than the time interval between microsteps at the largest allowed speed
   if (pos_short != g.pos_short_old)
@@ -127,6 +168,22 @@ void motor_control()
     // How many steps we'd need to take at this call:
     // If it is > 1, we've got a problem (skipped steps), potential solution is below, in PRECISE_STEPPING module
     COORD_TYPE d = abs(pos_short - g.pos_short_old);
+#ifdef INPUT_SHAPER
+    if (g.sh_n > 1 && d > 1)
+    {
+      // The shaped motion can't be moved back in time as below; the motor makes one microstep, and catches up in the next loops:
+      pos_short = g.pos_short_old + (pos_short > g.pos_short_old ? 1 : -1);
+      d = 1;
+    }
+#endif
+#ifdef MICROSTEP_SWITCH
+    if (g.ms_coarse)
+      // Exactly one full step was made (see above); full steps are N_MICROSTEPS times less frequent, so no skipped steps correction:
+      d = 1;
+    else
+      // One microstep was made:
+      g.ms_phase = (g.ms_phase + (pos_short > g.pos_short_old ? 1 : -1)) & (N_MICROSTEPS - 1);
+#endif
 
 #ifdef PRECISE_STEPPING               //  Precise stepping module
     //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -134,16 +191,20 @@ void motor_control()
     // when we are back in the past around the time the correct step should have been taken.
     // This is just a fix, not a good solution if your SPEED_LIMIT is so high that the Arduino loop becomes
     // comparable or longer than the time interval between motor steps at the highest speed allowed.
-    // Do some TIMING tests to figure out the timings, if you use parts with different specs (motor, rail, LCD, keypad).
+    // Use TELEMETRY to figure out the timings, if you use parts with different specs (motor, rail, LCD, keypad).
     // In my setup, average Arduino loop length is 250 us when moving, or
     // about 50% of the microstep interval when moving at the maximum (5 mm/s) speed; the longest loops are
     // around 120%, but my rail skips only a couple of steps per 10,000 steps on average. This is easily
     // fixable (see below). If you get a sizable fraction (say, more than 5 percent) of the steps skipped,
     // you need to lower down your SPEED_LIMIT. For an arbitrary rail and motor, make sure the following condition is met:
-    // 10^6 * MM_PER_ROTATION / (MOTOR_STEPS * N_MICROSTEPS * SPEED_LIMIT_MM_S) >~ 500 microseconds
+    // 10^6 * MM_PER_ROTATION / (MOTOR_STEPS * N_MICROSTEPS * SPEED_LIMIT_MM_S) >= 450 microseconds (~500 or more is safer)
+    // (checked at compile time, with the static_assert for STEP_DT_MIN in stacker.h)
     char d_sign;
     if (d > 1)
     {
+#ifdef TELEMETRY
+      g.skipped_steps++;
+#endif
       // The single step with a corresponding sign which should have been taken
       if (pos_short > g.pos_short_old)
         d_sign = 1;
@@ -207,7 +268,7 @@ void motor_control()
 
       // Sanity checks:
       // The single step event should have happened somewhere between t_old and t:
-      if (dt1_backlash > 0 && dt1_backlash < g.t - g.t_old)
+      if (dt1_backlash > 0 && (unsigned long)dt1_backlash < g.t - g.t_old)
       {
         // Moving back in time:
         g.t = g.t - dt1_backlash;
@@ -235,23 +296,45 @@ void motor_control()
       g.BL_counter = g.backlash;
 
     // Saving the current position as old:
+#ifdef LIMITER_INT
+    // (pos_short_old is read by the limiter interrupt, so the two-byte write has to be atomic)
+    noInterrupts();
+    g.pos_short_old = pos_short;
+    interrupts();
+#else
     g.pos_short_old = pos_short;
+#endif
     g.pos_old = g.pos;
     // Old speed (to use to detect when the direction has to change):
-    g.speed_old = g.speed;
+    g.speed_old = speed_m;
   }  // if (pos_short != g.pos_short_old)
 
+#ifdef INPUT_SHAPER
+  if (g.sh_stop && g.t - g.t_sh_stop >= (g.sh_n - 1) * g.sh_tau && g.pos_short_old == floorMy(g.pos))
+  {
+    // The rail caught up with the commanded motion:
+    g.sh_stop = 0;
+    stop_now();
+    return;
+  }
+#endif
+
   if (g.moving_mode == 1)
     // Used in go_to mode
   {
     // For small enough speed, we stop instantly when reaching the target location (or overshoot the precise location):
-    if ((g.speed1 >= 0.0 && g.speed >= 0.0 && g.pos >= g.pos_goto || g.speed1 <= 0.0 && g.speed <= 0.0 && g.pos <= g.pos_goto))
+    if ((g.speed1 >= 0.0 && g.speed >= 0.0 && g.pos >= g.pos_goto) || (g.speed1 <= 0.0 && g.speed <= 0.0 && g.pos <= g.pos_goto))
       // Just a hack for now (to fix a rare bug when rail keeps moving and not stopping)
       //        && fabs(g.speed) < SPEED_SMALL + SPEED_TINY)
     {
       new_accel = 0;
       instant_stop = 1;
-      stop_now();
+#ifdef INPUT_SHAPER
+      if (g.sh_n > 1)
+        shaper_stop();
+      else
+#endif
+        stop_now();
     }
 
     if (instant_stop == 0)
@@ -260,9 +343,9 @@ void motor_control()
       // Breaking is always done at maximum deceleration
       if (g.speed >= 0.0)
         //The additional -/+1.0 factor is to make the rail stop 1 step later on average, to deal with round-off errors
-        g.pos_stop = g.pos - 1.0 + 0.5 * (g.speed * g.speed) / ACCEL_LIMIT;
+        g.pos_stop = g.pos - 1.0 + breaking_factor() * (g.speed * g.speed);
       else
-        g.pos_stop = g.pos + 1.0 - 0.5 * (g.speed * g.speed) / ACCEL_LIMIT;
+        g.pos_stop = g.pos + 1.0 - breaking_factor() * (g.speed * g.speed);
 
       // Checking if pos_goto is bracketed between pos_stop_old and pos_stop (not checked first time):
       if (g.pos_stop_flag == 1 && ((g.pos_goto > g.pos_stop && g.pos_goto < g.pos_stop_old) || (g.pos_goto < g.pos_stop && g.pos_goto > g.pos_stop_old)))
@@ -292,10 +375,86 @@ void motor_control()
     g.pos0 = g.pos;
     g.speed0 = g.speed;
     g.accel = new_accel;
+#ifdef INPUT_SHAPER
+    if (g.sh_n > 1)
+      shaper_push();
+#endif
   }
 
 
   return;
 }
 
-
+
+#ifdef MICROSTEP_SWITCH
+void microstep_switch()
+/* Deciding when to switch the driver between microsteps and full steps (called from motor_control() while moving).
+   Full steps are only used for fast travel outside of stacking, and can only be started from a full step position of the driver.
+ */
+{
+  if (g.ms_coarse == 0)
+  {
+    if (g.ms_phase == 0 && g.stacker_mode <= 1 && fabs(g.speed) > MS_SPEED
+#ifndef HOMING
+        // Without homing, the limiter positions would only be accurate to a full step:
+        && g.calibrate_flag == 0
+#endif
+       )
+    {
+#ifndef DISABLE_MOTOR
+      digitalWrite(PIN_MS, LOW);
+#endif
+      g.ms_coarse = 1;
+    }
+  }
+  else if (fabs(g.speed) < MS_SPEED)
+    set_fine_steps();
+
+  return;
+}
+
+
+void set_fine_steps()
+/* Switching the driver back to microsteps. In the full step mode the motor lags behind g.pos by up to N_MICROSTEPS-1 microsteps (a bit more
+   if it was still catching up after a slow loop); the missing microsteps are made here right away (normally less than one full step, which the
+   motor was doing anyway).
+ */
+{
+  COORD_TYPE pos_short = floorMy(g.pos);
+  COORD_TYPE d = pos_short - g.pos_short_old;
+
+#ifndef DISABLE_MOTOR
+  digitalWrite(PIN_MS, HIGH);
+#endif
+  g.ms_coarse = 0;
+
+  for (COORD_TYPE i = 0; i < abs(d); i++)
+  {
+#ifndef DISABLE_MOTOR
+    digitalWrite(PIN_STEP, LOW);
+#endif
+    delayMicroseconds(STEP_LOW_DT);
+#ifndef DISABLE_MOTOR
+    digitalWrite(PIN_STEP, HIGH);
+#endif
+    delayMicroseconds(STEP_LOW_DT);
+  }
+  g.ms_phase = (g.ms_phase + d) & (N_MICROSTEPS - 1);
+
+  // Same bookkeeping as in motor_control():
+  g.BL_counter = g.BL_counter - d;
+  if (g.BL_counter < (COORD_TYPE)0)
+    g.BL_counter = 0;
+  if (g.BL_counter > g.backlash)
+    g.BL_counter = g.backlash;
+#ifdef LIMITER_INT
+  noInterrupts();
+  g.pos_short_old = pos_short;
+  interrupts();
+#else
+  g.pos_short_old = pos_short;
+#endif
+
+  return;
+}
+#endif
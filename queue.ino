@@ -0,0 +1,185 @@
+#ifdef JOB_QUEUE
+/* Unattended job queue: up to N_JOBS 2-point stacks (a memory bank, and the continuous or non-continuous mode), shot back-to-back.
+
+   The queue and the progress (current job, and the stacks done in it) are kept in EEPROM, so the queue survives a power cycle. A job is a
+   regular stack (or timelapse sequence of stacks) with the parameters read from its memory bank, so everything else (backlash compensation,
+   pausing with any key, resuming with "0") works as usual.
+*/
+
+void job_key()
+/* "*#": starting the recording of a new queue; ending the recording and running the queue; or resuming an unfinished queue.
+ */
+{
+  if (g.stacker_mode || g.job_mode >= 3)
+    return;
+
+  if (g.job_mode == 1)
+    // End of recording:
+  {
+    if (g.job_n == 0)
+    {
+      g.job_mode = 0;
+      display_comment_line(" Queue empty  ");
+      return;
+    }
+    g.job_i = 0;
+    EEPROM.put( ADDR_JOB_I, g.job_i);
+    EEPROM.put( ADDR_JOB_DONE, (short)0);
+  }
+  else if (g.job_i >= g.job_n)
+    // Recording a new queue:
+  {
+    g.job_n = 0;
+    g.job_i = 0;
+    EEPROM.put( ADDR_JOB_N, g.job_n);
+    EEPROM.put( ADDR_JOB_I, g.job_i);
+    g.job_bank = 0;
+    g.job_mode = 1;
+    display_comment_line("Queue: record ");
+    return;
+  }
+
+  // Running the queue from the current job (from the first one, or from where it was interrupted):
+  job_start();
+  return;
+}
+
+
+void job_add(byte continuous)
+/* Recording: "0" or "#0" adds a job with the last memory bank read or saved.
+ */
+{
+  if (g.job_bank == 0)
+  {
+    display_comment_line(" Read a Reg!  ");
+    return;
+  }
+  if (g.job_n >= N_JOBS)
+  {
+    display_comment_line(" Queue full!  ");
+    return;
+  }
+  EEPROM.put( ADDR_JOBS + g.job_n, (byte)(g.job_bank | (continuous << 7)));
+  g.job_n++;
+  EEPROM.put( ADDR_JOB_N, g.job_n);
+  sprintf(g.buffer, "Job %2d: Reg%1d %c", (int)constrain(g.job_n, 0, 99), (int)constrain(g.job_bank, 0, 9), continuous ? 'C' : 'N');
+  display_comment_line(g.buffer);
+  return;
+}
+
+
+void job_start()
+/* Loading the memory bank of the current job (with the rail reversal, if needed). The stack is initiated by job_go() once the rail is at rest.
+ */
+{
+  byte job;
+  EEPROM.get( ADDR_JOBS + g.job_i, job);
+  byte n = job & 0x7F;
+  read_params(ADDR_REG1 + (n - 1) * SIZE_REG, n);
+  g.continuous_mode = job >> 7;
+  g.job_mode = 3;
+  return;
+}
+
+
+void job_go()
+/* Called from camera(): initiating the current job, once the rail is at rest after loading its memory bank (the backlash compensation loop
+   of the rail reversal is done in place, before travelling to the point 1).
+ */
+{
+  if (g.job_mode != 3 || g.moving || g.started_moving || g.backlashing || g.BL_counter != (COORD_TYPE)0)
+    return;
+
+  // The memory bank could have been changed after the job was added:
+  if (!(g.point2 > g.point1 && g.point1 >= g.limit1 && g.point2 <= g.limit2))
+  {
+    // The queue stays unfinished ("*#" will try again):
+    g.job_mode = 0;
+    display_comment_line("Bad 2 points! ");
+    return;
+  }
+
+  g.job_mode = 2;
+  g.Nframes = Nframes();
+  g.starting_point = g.point1;
+  g.destination_point = g.point2;
+  g.stacker_mode = 1;
+  g.start_stacking = 0;
+  // Resuming after a power cycle from the interrupted stack:
+  EEPROM.get( ADDR_JOB_DONE, g.timelapse_counter);
+  if (g.timelapse_counter < 0 || g.timelapse_counter >= n_timelapse())
+    g.timelapse_counter = 0;
+#ifdef SERPENTINE
+  // (a resumed sequence keeps the direction of every stack)
+  serpentine_start();
+#else
+  go_to((float)g.point1 + 0.5, g.speed_limit);
+#endif
+  g.timelapse_mode = n_timelapse() > 1;
+  sprintf(g.buffer, "Job %2d of %2d ", (int)constrain(g.job_i + 1, 0, 99), (int)constrain(g.job_n, 0, 99));
+  display_comment_line(g.buffer);
+  return;
+}
+
+
+void job_save(short done)
+/* Saving the progress of the running job to EEPROM (only the changed bytes are written).
+ */
+{
+  if (g.job_mode != 2)
+    return;
+  EEPROM.put( ADDR_JOB_I, g.job_i);
+  EEPROM.put( ADDR_JOB_DONE, done);
+  return;
+}
+
+
+byte job_next()
+/* Called at the end of the last stack of a job (with the rail at rest). Waits dt_timelapse() since the start of that stack, and then loads the
+   next job. Returns 1 if the end of the stack was handled here, 0 if not running a queue.
+ */
+{
+  if (g.job_mode == 2)
+    // The job is done:
+  {
+    g.job_i++;
+    job_save(0);
+    if (g.job_i >= g.job_n)
+    {
+      g.job_mode = 0;
+      g.end_of_stacking = 0;
+      g.timelapse_mode = 0;
+      display_all();
+      display_comment_line("  Queue done  ");
+      return 1;
+    }
+    g.job_mode = 4;
+  }
+  if (g.job_mode != 4)
+    return 0;
+
+  // Waiting before the next job, the same way as between the stacks of a timelapse sequence:
+  g.stacker_mode = 4;
+  g.t_mil = millis();
+  if (((float)(g.t_mil - g.t0_mil)) / 1000.0 > (float)dt_timelapse())
+  {
+    g.end_of_stacking = 0;
+    g.stacker_mode = 0;
+    job_start();
+  }
+  return 1;
+}
+
+
+void job_abort()
+/* A paused stack was aborted ("#B"): dropping the queue.
+ */
+{
+  if (g.job_mode < 2)
+    return;
+  g.job_mode = 0;
+  g.job_i = g.job_n;
+  EEPROM.put( ADDR_JOB_I, g.job_i);
+  return;
+}
+#endif
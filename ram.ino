@@ -0,0 +1,46 @@
+/* SRAM usage report (RAM_DEBUG).
+
+   The free RAM between the heap and the stack is painted with RAM_PAINT at startup. The stack high-water mark is found later
+   as the lowest address where the paint was overwritten.
+ */
+
+#ifdef RAM_DEBUG
+// Symbols provided by the linker and avr-libc:
+extern char __data_start, __bss_end, __heap_start;
+extern char *__brkval;
+const byte RAM_PAINT = 0xA5;
+
+void ram_paint()
+// Painting the free RAM (called at the start of setup())
+{
+  char *p = __brkval ? __brkval : &__heap_start;
+  // Leaving alone a few bytes below the stack pointer (the stack frame of this function):
+  char *sp = (char *)SP - 8;
+
+  while (p < sp)
+    *p++ = RAM_PAINT;
+
+  return;
+}
+
+
+void display_ram()
+/* Displaying static RAM, the smallest free RAM since startup, and the current free RAM (in bytes)
+   at the current LCD line.
+ */
+{
+  char *heap_end = __brkval ? __brkval : &__heap_start;
+  char *p = heap_end;
+
+  // The lowest stack address ever used:
+  while (p < (char *)SP && *p == RAM_PAINT)
+    p++;
+
+  sprintf(g.buffer, "%4u %4u %4u", (unsigned short)(&__bss_end - &__data_start), (unsigned short)(p - heap_end),
+          (unsigned short)((char *)SP - heap_end));
+  lcd.print(g.buffer);
+
+  return;
+}
+#endif
+
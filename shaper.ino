@@ -0,0 +1,153 @@
+#ifdef INPUT_SHAPER
+/* Input shaping of the rail moves.
+
+   motor_control() solves the equation of motion as usual (g.pos, g.speed are the commanded motion), but the motor follows the shaped position: the
+   sum of the commanded positions g.sh_a[k] at the times k*g.sh_tau in the past (k = 0 ... g.sh_n-1). To compute it, the segments of the commanded
+   motion (constant acceleration index) are kept in a small ring buffer. When the commanded motion stops, the rail keeps moving (g.moving=1) for
+   (g.sh_n-1)*g.sh_tau more, until the shaped position arrives at the same target.
+*/
+
+void shaper_init()
+/* Computing the shaper impulses for the current model (g.i_shaper). Only when the rail is at rest.
+ */
+{
+  byte type = pgm_read_byte(&SHAPERS[g.i_shaper].type);
+  float f = pgm_read_float(&SHAPERS[g.i_shaper].f_hz);
+  float zeta = pgm_read_float(&SHAPERS[g.i_shaper].zeta);
+  g.sh_n = 1;
+  g.sh_a[0] = 1.0;
+  g.sh_stop = 0;
+  if (type == 0 || f <= 0.0)
+    return;
+
+  float s = sqrt(1.0 - zeta * zeta);
+  // Half of the damped vibration period:
+  g.sh_tau = (unsigned long)(0.5e6 / (f * s));
+  // Amplitude ratio of two consecutive half periods:
+  float K = exp(-PI * zeta / s);
+  if (type == 1)
+    // ZV:
+  {
+    g.sh_n = 2;
+    g.sh_a[0] = 1.0 / (1.0 + K);
+    g.sh_a[1] = K / (1.0 + K);
+  }
+  else
+    // ZVD:
+  {
+    g.sh_n = 3;
+    g.sh_a[0] = 1.0 / ((1.0 + K) * (1.0 + K));
+    g.sh_a[1] = 2.0 * K * g.sh_a[0];
+    g.sh_a[2] = K * K * g.sh_a[0];
+  }
+  return;
+}
+
+
+void shaper_start()
+/* A move starts now (called from motor_control()): the rail was at rest before.
+ */
+{
+  for (byte i = 0; i < N_SHAPER_SEG; i++)
+    g.sh_seg[i] = {g.t0, g.pos0, g.speed0, g.accel};
+  g.sh_i = 0;
+  g.sh_stop = 0;
+  return;
+}
+
+
+void shaper_push()
+/* The commanded motion changed (g.t0, g.pos0, g.speed0, g.accel were updated): adding a new segment, unless the motion just continues.
+ */
+{
+  shaper_segment *s = &g.sh_seg[g.sh_i];
+  if (g.accel == s->accel && (g.accel != 0 || g.speed0 == s->speed0))
+    return;
+  g.sh_i = (g.sh_i + 1) % N_SHAPER_SEG;
+  g.sh_seg[g.sh_i] = {g.t0, g.pos0, g.speed0, g.accel};
+  if (g.accel != 0)
+    // Moving again:
+    g.sh_stop = 0;
+  return;
+}
+
+
+void shaper_stop()
+/* Called from motor_control() instead of stop_now(), when the commanded motion stops. The rail is stopped once it caught up.
+ */
+{
+  g.speed = 0.0;
+  if (g.sh_stop)
+    return;
+  g.sh_stop = 1;
+  g.t_sh_stop = g.t;
+  return;
+}
+
+
+float shaper_pos(float *speed)
+/* The shaped position at g.t (the commanded one is g.pos), and the shaped speed.
+ */
+{
+  float pos = g.pos;
+  *speed = g.speed;
+  for (byte k = 1; k < g.sh_n; k++)
+  {
+    unsigned long t = g.t - k * g.sh_tau;
+    // The last segment which started before t (or the oldest one remembered):
+    byte j = g.sh_i;
+    for (byte m = 1; m < N_SHAPER_SEG && (long)(t - g.sh_seg[j].t0) < 0; m++)
+      j = (j + N_SHAPER_SEG - 1) % N_SHAPER_SEG;
+    shaper_segment *s = &g.sh_seg[j];
+    float dt = (float)(long)(t - s->t0);
+    // Before the start of the move:
+    if (dt < 0.0)
+      dt = 0.0;
+    float a = g.accel_v[2 + s->accel];
+    // (the sum of the amplitudes is 1, so the shaped position is exactly g.pos once the commanded motion stopped long enough)
+    pos = pos + g.sh_a[k] * (s->pos0 + dt * (s->speed0 + 0.5 * a * dt) - g.pos);
+    *speed = *speed + g.sh_a[k] * (s->speed0 + a * dt - g.speed);
+  }
+  return pos;
+}
+
+
+void shaper_shift(float d)
+/* Shifting the commanded motion by d microsteps (the rail coordinates were corrected while moving).
+ */
+{
+  for (byte i = 0; i < N_SHAPER_SEG; i++)
+    g.sh_seg[i].pos0 = g.sh_seg[i].pos0 + d;
+  return;
+}
+
+
+#ifdef SHAPER_DEBUG
+void shaper_step(char d)
+/* Selecting the previous (d=-1) or the next (d=1) shaper model, and saving it in EEPROM.
+ */
+{
+  if (g.moving)
+    return;
+  g.i_shaper = (g.i_shaper + N_SHAPERS + d) % N_SHAPERS;
+  EEPROM.put( ADDR_I_SHAPER, g.i_shaper);
+  shaper_init();
+  return;
+}
+
+
+void display_shaper()
+/* Displaying the current shaper model in the comment line.
+ */
+{
+  byte type = pgm_read_byte(&SHAPERS[g.i_shaper].type);
+  if (type == 0)
+    sprintf(g.buffer, " No shaping   ");
+  else
+    sprintf(g.buffer, "%-3s%5s z%s", type == 1 ? "ZV" : "ZVD", ftoa(g.buf7, pgm_read_float(&SHAPERS[g.i_shaper].f_hz), 1),
+            ftoa(g.buf6, pgm_read_float(&SHAPERS[g.i_shaper].zeta), 2));
+  display_comment_line(g.buffer);
+  return;
+}
+#endif
+#endif
@@ -0,0 +1,207 @@
+/* Idle power management (IDLE_SLEEP).
+
+   When the rail is at rest and nothing is going on, the MCU is put to the idle sleep mode at the end of loop(), until the next timed event.
+   In the idle mode Timer0 keeps running, and its overflow interrupt (every 1.024 ms) wakes up the MCU briefly; it goes back to sleep right away
+   unless the next event is due, or a pin change interrupt happened. For the latter, all the keypad columns are pulled LOW during the sleep, so a key
+   press pulls its row pin LOW; the limiter pin is monitored as well.
+   There is no UART receive wake-up: the RX pin (0) is used for PIN_STEP.
+ */
+
+#ifdef IDLE_SLEEP
+byte idle()
+/* Returns 1 if the rail, the camera and the keypad are all idle (nothing can happen until a key is pressed, or a timed event is due).
+ */
+{
+  if (g.moving || g.started_moving || g.backlashing || g.breaking)
+    return 0;
+  // The first leg of a move in the bad direction just ended; backlash() will start the compensation leg in the next loop:
+  if (g.BL_counter > (COORD_TYPE)0 && g.calibrate == 0)
+    return 0;
+  if (g.shutter_on || g.make_shot || g.single_shot)
+    return 0;
+  // AF is kept on between the continuous stacks of a timelapse sequence; otherwise it is about to be released:
+  if (g.AF_on && (g.stacker_mode != 4 || g.continuous_mode == 0 || AF_SYNC))
+    return 0;
+  // Not stacking, or waiting for the next stack in a timelapse sequence:
+  if ((g.stacker_mode != 0 && g.stacker_mode != 4) || (g.end_of_stacking && g.stacker_mode != 4))
+    return 0;
+  if (g.calibrate && g.calibrate_warning == 0)
+    return 0;
+#ifdef HOMING
+  if (g.homing_flag)
+    return 0;
+#endif
+#ifdef BL_MAP_DEBUG
+  if (g.bl_cal_flag)
+    return 0;
+#endif
+#ifdef ACCEL_TUNE
+  if (g.tune_flag)
+    return 0;
+#endif
+#ifdef AXIS2
+  if (g.y_moving)
+    return 0;
+#endif
+#ifdef JOB_QUEUE
+  if (g.job_mode == 3)
+    return 0;
+#endif
+#ifdef FAST_STARTUP
+  if (g.boot_flag)
+    return 0;
+#endif
+  if (keypad.key[0].kstate != IDLE || keypad.key[1].kstate != IDLE)
+    return 0;
+  return 1;
+}
+
+
+unsigned long time_left(unsigned long t, unsigned long t_event, unsigned long dt)
+/* Time left (us) until the event which is due dt microseconds after t_event; 0 if overdue.
+ */
+{
+  if (t - t_event >= dt)
+    return 0;
+  return dt - (t - t_event);
+}
+
+
+void idle_sleep()
+/* Sleeping until a key is pressed, a limiter changes state, or the next timed event is due (only when idle()).
+ */
+{
+  if (idle() == 0)
+    return;
+
+  unsigned long t0 = clock_us();
+  // The longest sleep; it can only get shorter:
+  unsigned long dt = time_left(t0, g.t_display, DISPLAY_REFRESH_TIME);
+  if (g.comment_flag)
+    dt = min(dt, time_left(t0, g.t_comment, COMMENT_DELAY));
+  if (g.stacker_mode == 4)
+  {
+    // Next stack of the timelapse sequence (in ms, as it can be longer than the clock_us() range):
+    unsigned long dt_mil = time_left(millis(), g.t0_mil, 1000UL * dt_timelapse());
+    if (dt_mil < dt / 1000)
+      dt = 1000 * dt_mil;
+  }
+#ifdef TELEMETRY
+  dt = min(dt, time_left(t0, g.t_telemetry, TELEMETRY_DT));
+#endif
+  // Not worth it (the first Timer0 interrupt would end the sleep anyway):
+  if (dt < 2000)
+    return;
+
+  // Keypad: all the columns LOW (the rows have pullups), and the pin change interrupts for all the rows and the limiter pin:
+  byte pcicr = PCICR;
+  byte pcmsk0 = PCMSK0;
+  byte pcmsk1 = PCMSK1;
+  byte pcmsk2 = PCMSK2;
+  byte i;
+  for (i = 0; i < cols; i++)
+  {
+    pinMode(colPins[i], OUTPUT);
+    digitalWrite(colPins[i], LOW);
+  }
+  g.wakeup = 0;
+  for (i = 0; i < rows; i++)
+  {
+    *digitalPinToPCMSK(rowPins[i]) |= _BV(digitalPinToPCMSKbit(rowPins[i]));
+    PCICR |= _BV(digitalPinToPCICRbit(rowPins[i]));
+    // The key was pressed after the last keypad scan:
+    if (digitalRead(rowPins[i]) == LOW)
+      g.wakeup = 1;
+  }
+  *digitalPinToPCMSK(PIN_LIMITERS) |= _BV(digitalPinToPCMSKbit(PIN_LIMITERS));
+  PCICR |= _BV(digitalPinToPCICRbit(PIN_LIMITERS));
+
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  while (g.wakeup == 0 && clock_us() - t0 < dt)
+  {
+    // Checking the flag and going to sleep with the interrupts disabled, so an interrupt can't be missed in between
+    // (sleep_cpu() is executed right after sei(), before any pending interrupt):
+    cli();
+    if (g.wakeup == 0)
+    {
+      sleep_enable();
+      sei();
+      sleep_cpu();
+      sleep_disable();
+    }
+    sei();
+  }
+
+  // Restoring the keypad columns (as Keypad::scanKeys() leaves them), and the pin change interrupts:
+  noInterrupts();
+  PCMSK0 = pcmsk0;
+  PCMSK1 = pcmsk1;
+  PCMSK2 = pcmsk2;
+  PCICR = pcicr;
+  interrupts();
+  for (i = 0; i < cols; i++)
+  {
+    digitalWrite(colPins[i], HIGH);
+    pinMode(colPins[i], INPUT);
+  }
+
+  g.t_sleep = g.t_sleep + (clock_us() - t0);
+  return;
+}
+
+
+void duty_cycle()
+/* Measuring the duty cycle (percentage of time the MCU was awake) since the previous call; called with each display refresh.
+ */
+{
+  unsigned long t = clock_us();
+  unsigned long dt = t - g.t_duty0;
+  if (dt == 0)
+    return;
+  g.duty = 100 - (byte)(100.0 * (float)g.t_sleep / (float)dt);
+  g.t_sleep = 0;
+  g.t_duty0 = t;
+#ifndef RAM_DEBUG
+  if (g.alt_flag)
+    display_duty();
+#endif
+  return;
+}
+
+
+void display_duty()
+/* Displaying the duty cycle and the estimated current in line 5.
+ */
+{
+  lcd.setCursor(0, 4);
+  snprintf(g.buffer, sizeof(g.buffer), "Duty=%3d%% %2dmA", min(g.duty, (byte)100), (int)constrain(I_SLEEP_MA + 0.01 * g.duty * (I_AWAKE_MA - I_SLEEP_MA) + 0.5, 0, 99));
+  lcd.print(g.buffer);
+  return;
+}
+
+
+// Waking up from the idle sleep when a key is pressed (the row pins on ports C and D; the limiter and the row pin 12 on port B are
+// handled by the PCINT0 interrupt):
+ISR(PCINT1_vect)
+{
+  g.wakeup = 1;
+}
+
+ISR(PCINT2_vect)
+{
+  g.wakeup = 1;
+}
+
+#ifndef LIMITER_INT
+ISR(PCINT0_vect)
+{
+  g.wakeup = 1;
+#ifdef FLASH_SYNC
+  flash_latch();
+#endif
+#ifdef ENCODER
+  encoder_count();
+#endif
+}
+#endif
+#endif
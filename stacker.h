@@ -13,40 +13,203 @@
 
 
 //////// Debugging options ////////
-// Integer type for all coordinates. Use "short" if the total number of microsteps for your rail is <32,000 (this is the case with my hardware - Velbon Super Mag Slider,
-// 1.8 degrees stepper motor and 8 microsteps/step motor driver), and use "long" for larger numbers (will consume more memory)
-#define COORD_TYPE short
-// For timing the main loop:
-//#define TIMING
+
+
+//////// Rail profiles ////////
+// Uncomment the profile for your rail and motor combination (or add a new profile with the same set of constants):
+#define RAIL_VELBON
+//#define RAIL_LEADSCREW_1MM
+//
+// Profile parameters:
+// MOTOR_STEPS: number of full steps per rotation for the stepper motor.
+// N_MICROSTEPS: number of microsteps in a step (default for EasyDriver is 8).
+// MM_PER_ROTATION: macro rail travel distance per one rotation, in mm.
+// RAIL_TRAVEL_MM: total travel of the rail, in mm (only used to choose the integer type for coordinates, COORD_TYPE).
+// BACKLASH_MM: backlash compensation (in mm); positive direction (towards background) is assumed to be the good one (no BL compensation required);
+//   all motions moving in the bad (negative) direction at the end will need some BL compensation.
+//   Using the simplest BL model (assumption: rail physically doesn't move until rewinding the full g.backlash amount,
+//   and then instantly starts moving; same when moving to the positive direction after moving to the bad direction).
+//   The algorithm guarantees that every time the rail comes to rest, it is fully BL compensated (so the code coordinate = physical coordinate).
+//   Should be determined experimentally: too small values will produce visible backlash (two or more frames at the start of the stacking
+//   sequence will look alsmost identical). For my Velbon Super Mag Slide rail I measured the BL to be ~0.2 mm.
+//   Set it to zero to disable BL compensation.
+// BACKLASH_2_MM: the second backlash related parameter you need to measure for you rail.
+//   This parameter is only relevant for one operation - rail reversal (*1 function). Unlike the above parameter (BACKLASH_MM) which can be equal to or
+//   larger than the actual backlash value for the rail movements to be perfectly accurate, the BACKLASH_2 parameter has to have a specific value (not larger, no smaller); if
+//   your rail backlash changes as a function of the rail angle, position on the rail, camera weight etc., BACKLASH_2 would have to change as well.
+//   Because it is not practical, your value of BACKLASH_2 should be a compromise, giving reasonable results under normal usage scenario. In any case
+//   rail reversal (*1) wasn't meant to be a perfectly accurate operation, whereas the standard backlash compensation is.
+//   Use the BL2_DEBUG mode to find the good value of this parameter. You should convert the displayed value of BL2_DEBUG from microsteps
+//   to mm, by multiplying by MM_PER_ROTATION/(MOTOR_STEPS*N_MICROSTEPS).
+//   Adjust this parameter only after you found a good value for BACKLASH_MM parameter.
+// SPEED_LIMIT_MM_S: speed limiter, in mm/s. Higher values will result in lower torques and will necessitate larger travel distance
+//   between the limiting switches and the physical limits of the rail. In addition, too high values will result
+//   in Arduino loop becoming longer than inter-step time interval, which can screw up the algorithm.
+//   The following condition is checked at compile time (see STEP_DT_MIN below):
+//   10^6 * MM_PER_ROTATION / (MOTOR_STEPS * N_MICROSTEPS * SPEED_LIMIT_MM_S) >= 450 microseconds (~500 or more is safer)
+//   This speed limits is normally used only with AC power (which provides mor torque).
+// SPEED_LIMIT2_MM_S: the second (smaller) speed limit (used only with a battery power, which provides less torque).
+// BREAKING_DISTANCE_MM: breaking distance (mm) for the rail when stopping while moving at the fastest speed (SPEED_LIMIT)
+//   This will determine the maximum acceleration/deceleration allowed for any rail movements - important
+//   for reducing the damage to the (mostly plastic) rail gears. Make sure that this distance is smaller
+//   than the smaller distance of the two limiting switches (between the switch actuation and the physical rail limits)
+#ifdef RAIL_VELBON
+// My hardware: Velbon Super Mag Slider, 1.8 degrees stepper motor, EasyDriver
+const short MOTOR_STEPS = 200;
+const short N_MICROSTEPS = 8;
+constexpr float MM_PER_ROTATION = 3.98;
+constexpr float RAIL_TRAVEL_MM = 70.0;
+constexpr float BACKLASH_MM = 0.2;
+constexpr float BACKLASH_2_MM = 0.3333;
+// 5 mm/s seems to be a reasonable compromize, for my motor and rail:
+constexpr float SPEED_LIMIT_MM_S = 5;
+constexpr float SPEED_LIMIT2_MM_S = 2.5;
+constexpr float BREAKING_DISTANCE_MM = 2.0;
+#endif
+#ifdef RAIL_LEADSCREW_1MM
+// A rail with 1 mm pitch lead screw, 1.8 degrees stepper motor, EasyDriver. The backlash values are just a starting point - measure yours with BL_DEBUG
+// and BL2_DEBUG. The fine pitch means long coordinates, and a low speed limit (because of the microstep interval condition):
+const short MOTOR_STEPS = 200;
+const short N_MICROSTEPS = 8;
+constexpr float MM_PER_ROTATION = 1.0;
+constexpr float RAIL_TRAVEL_MM = 100.0;
+constexpr float BACKLASH_MM = 0.05;
+constexpr float BACKLASH_2_MM = 0.08;
+constexpr float SPEED_LIMIT_MM_S = 1.2;
+constexpr float SPEED_LIMIT2_MM_S = 0.6;
+constexpr float BREAKING_DISTANCE_MM = 0.5;
+#endif
+
+// Number of microsteps for the whole rail travel:
+constexpr float RAIL_MICROSTEPS = RAIL_TRAVEL_MM / MM_PER_ROTATION * MOTOR_STEPS * N_MICROSTEPS;
+// Integer type for all coordinates: "short" if the total number of microsteps for the rail is <30,000 (this is the case with my hardware - Velbon Super Mag Slider,
+// 1.8 degrees stepper motor and 8 microsteps/step motor driver; the rest of the short range is left for the coordinates beyond the limiters during calibration),
+// and "long" for larger numbers (will consume more memory). Chosen at compile time:
+template <bool fits_short> struct coord_select
+{
+  typedef long type;
+};
+template <> struct coord_select<true>
+{
+  typedef short type;
+};
+typedef coord_select<(RAIL_MICROSTEPS < 30000.0)>::type coord_t;
+#define COORD_TYPE coord_t
+// Uncomment to stream live telemetry (position, speed, acceleration, stacking state, battery voltage, skipped steps, loop timing)
+// over the UART TX line as fixed-size binary records (see struct telemetry_record below). Replaces the old LCD-only TIMING,
+// BATTERY_DEBUG and CAMERA_DEBUG modes. Requires hardware h1.3: PIN_DIR moved from pin 1 (UART TX) to pin 10.
+//#define TELEMETRY
+// Uncomment to switch the motor driver to full steps during fast travel (rewinds, travel to the starting point, calibration legs), and back to
+// N_MICROSTEPS microsteps for slow moves and for stacking. This reduces the number of step pulses of fast travel by a factor of N_MICROSTEPS (the loop time requirements stay the same: the microsteps are still made at SPEED_LIMIT while stacking).
+// The coordinates are still in microsteps; full steps are only made from full step positions of the driver (tracked in g.ms_phase, assuming the driver
+// is powered up together with Arduino). Requires a hardware modification (h1.3m): EasyDriver's MS1 and MS2 pins wired together to pin 10.
+// N_MICROSTEPS has to be a power of 2. Don't use MICROSTEP_SWITCH together with TELEMETRY or ENCODER (all use pin 10), or INPUT_SHAPER!
+//#define MICROSTEP_SWITCH
+// Uncomment to use the second (lateral) motorized axis, for unattended multi-position stacking: with the job mode on (*#: number of lateral
+// positions larger than 1), the 2-point stacking ("0" or "#0") makes a full stack at each of the lateral positions, AXIS2_DY_MM apart (starting from
+// the current one); the lateral axis moves while the focusing axis travels back to point1. With timelapse, each stack of the timelapse is a job.
+// Requires a hardware modification (h1.4): the second STEP/DIR driver on pins 10 and 9 (no LCD backlight then).
+// Don't use AXIS2 together with TELEMETRY, MICROSTEP_SWITCH (pin 10), FLASH_SYNC (pin 9) or ENCODER (pins 9, 10)!
+//#define AXIS2
+// Uncomment for the closed-loop non-continuous stacking ("#0"): the rail moves to the next frame FLASH_SYNC_DELAY after the camera's flash sync
+// signal, instead of after the fixed SECOND_DELAY, which becomes the timeout after which a missed shot is retried (up to FLASH_RETRIES times).
+// At the end of each stack the shutter-to-flash latency (average/maximum, ms) and the number of missed shots are shown in the comment line.
+// Requires a hardware modification (h1.5): the flash sync input on pin 9 (no LCD backlight then). Don't use FLASH_SYNC together with AXIS2 or ENCODER (pin 9)!
+//#define FLASH_SYNC
+// Uncomment for the closed-loop position verification with an incremental (quadrature) encoder on the motor shaft: the encoder position is compared
+// with the commanded one while moving and at the end of every move. A slip of the motor while moving (by more than ENCODER_SLIP_STEPS) is corrected
+// on the fly (the rail coordinates follow the encoder, so the move just takes a bit longer); a larger difference at the end of a move is corrected
+// with an extra move (up to ENCODER_RETRIES times). Repeated slips within ENCODER_STALL_DT are treated as a stalled motor: emergency breaking, and
+// no more stacking. The corrected microsteps are shown in the comment line. With the lost steps detected, SPEED_LIMIT_MM_S and BREAKING_DISTANCE_MM
+// can be set closer to the torque limit of the motor.
+// Requires a hardware modification (h1.6): the encoder channel A on pin 9 (no LCD backlight then), channel B on pin 1, and PIN_DIR moved to pin 10
+// (as in h1.3). Don't use ENCODER together with TELEMETRY (pin 1), MICROSTEP_SWITCH (pin 10), AXIS2 (pins 9, 10), FLASH_SYNC (pin 9) or DISABLE_MOTOR!
+//#define ENCODER
+// Uncomment for the unattended job queue: an ordered list of up to N_JOBS stacks (memory bank + continuous or non-continuous mode), saved in EEPROM
+// and shot back-to-back. "*#" starts recording a new queue: read (or save) a memory bank, then press "0" or "#0" to add a job with that bank instead of
+// starting the stack. "*#" again ends the recording and runs the queue. Each job uses all the parameters of its bank, including the rail reversal
+// (when the bank's rail direction differs) and the timelapse (N stacks, dt apart; the next job starts dt after the last stack of the job started).
+// The rail travels directly from the end of one job to the point 1 of the next one. The progress is saved in EEPROM after every stack, so after a power
+// cycle "*#" resumes the queue (from the interrupted stack); aborting a paused stack ("#B") drops the queue. The progress is shown in line 6 of the
+// alternative display ("*").
+//#define JOB_QUEUE
+// Uncomment for the stop-and-go continuous stacking ("0"): when the continuous speed would move the rail by more than STOP_AND_GO_BLUR_UM during
+// an exposure, the rail slows down to that speed for each shot (for STOP_AND_GO_EXPOSURE_US after the shutter is triggered), and speeds up between
+// the frames, so the next frame is still reached at the frame rate (or as soon as the acceleration allows). It is still one continuous move: no stops,
+// no first/second delays, and the motor stays enabled. The acceleration between the frames is ACCEL_LIMIT / accel_factor (the "accel" parameter).
+// Slower continuous stacks (and the non-continuous ones) are not affected.
+//#define STOP_AND_GO
+// Uncomment for the fast startup: every time the rail comes to rest with the backlash compensated, its state (position and limits, with a checksum)
+// is saved in EEPROM as a clean boot record, which is marked as not clean as soon as the rail starts moving again. At power-up a clean record (agreeing
+// with the saved position and limits) is trusted: the rail is ready right away, without the power-on backlash loop. If the power was switched off while
+// the rail was moving (or calibrating), the position is verified against the foreground limiter only (quick verify; the rail length is known from the
+// record), instead of trusting the last saved position. Without a good record (e.g. after a factory reset) the startup is the usual one. The time from
+// power-up until the rail is ready is displayed in the comment line. This adds EEPROM writes (the flag and the record) for every move outside of the
+// non-continuous stacks, so it wears the EEPROM a bit faster (the frame steps of a non-continuous stack only write at the stack start and end).
+// Don't move the carriage by hand while the power is off!
+//#define FAST_STARTUP
+// Uncomment for the serpentine timelapse: the even stacks of a continuous timelapse sequence (the 2nd, 4th, ...) are shot backwards, from point 2 to
+// point 1, instead of rewinding to point 1 after every stack. The frames of a backward stack are exactly the frames of a forward one, in the reverse
+// order. A backward stack runs with the backlash taken up (the shots are g.backlash microsteps early, in rail coordinates), so it is only as
+// accurate as the backlash value - measure it (BL_DEBUG, BL_MAP_DEBUG). Non-continuous stacks are always shot forward (backwards, every frame would
+// need a backlash compensation loop). During a backward stack the displayed frame number is the number of the frame in the forward order (so the
+// frames of all the stacks can be matched), and with TELEMETRY bit 6 of the flags is set. Don't use SERPENTINE together with AXIS2 or STOP_AND_GO!
+//#define SERPENTINE
+// Uncomment for the acceleration tuning for the payload (camera and lens) mounted on the rail: pressing "A" (instead of any key) on the calibration
+// warning screen ("#C") runs the full calibration, followed by a routine which makes ACCEL_TUNE_MOVES round trips between the soft limits at each
+// acceleration of the TUNED_ACCEL table (from the smallest one), and then homes the foreground limiter to check for lost steps (the limiter is found
+// more than ACCEL_TUNE_TOL microsteps away from where it was before the test moves). The test stops at
+// the first acceleration which loses steps (the rail coordinates are then corrected), and the largest one which didn't is used instead of ACCEL_LIMIT
+// for all the moves (rewinds and fast-forwards are still slower by accel_factor). It is displayed in the comment line (in units of ACCEL_LIMIT), and
+// saved with the memory registers, so each bank can have its own payload. Requires HOMING. Don't use ACCEL_TUNE together with ENCODER (the slips are
+// corrected on the fly, so the homing can't see them)!
+//#define ACCEL_TUNE
 // Motor debugging mode: limiters disabled (used for finetuning the motor alignment with the macro rail knob, finding the minimum motor current,
 // and software debugging without the motor unit)
 //#define MOTOR_DEBUG
 // Uncomment this line when debugging the control unit without the motor unit:
 //#define DISABLE_MOTOR
-// Battery debugging mode (prints actual voltage per AA battery in the status line; needed to determine the lowest voltage parameter, V_LOW - see below)
-//#define BATTERY_DEBUG
-// If defined, do camera debugging:
-//#define CAMERA_DEBUG
 // If defined, software SPI emulation instead of the default harware SPI. Try this if your LCD doesn't work after upgrading to h1.1 or newer and s0.10 or newer
 //#define SOFTWARE_SPI
 // Uncomment this line to measure the BACKLASH parameter for your rail (you don't need this if you are using Velbon Super Mag Slider - just use my value of BACKLASH)
 // When BL_DEBUG is defined, two keys get reassigned: keys "2" and "3" become "reduce BACKLASH" and "increase BACKLASH" functions
-// Don't use BL_DEBUG together with either BL2_DEBUG or DELAY_DEBUG!
+// Don't use BL_DEBUG together with BL2_DEBUG, DELAY_DEBUG, SETTLE_DEBUG or SHAPER_DEBUG!
 //#define BL_DEBUG
 // Uncomment this line to measure the BACKLASH_2 parameter for your rail (you don't need this if you are using Velbon Super Mag Slider - just use my value of BACKLASH_2)
 // When BL2_DEBUG is defined, two keys get reassigned: keys "2" and "3" become "reduce BACKLASH_2" and "increase BACKLASH_2" functions
-// Don't use BL2_DEBUG together with either BL_DEBUG or DELAY_DEBUG!
+// Don't use BL2_DEBUG together with BL_DEBUG, DELAY_DEBUG, SETTLE_DEBUG or SHAPER_DEBUG!
 //#define BL2_DEBUG
 // Step for changing both BACKLASH and BACKLASH_2, in microsteps:
 const COORD_TYPE BL_STEP = 1;
+// Uncomment this line to run the automatic backlash measurement (for the BL_MAP feature - see below). The measurement is initiated with "*#":
+// the rail slowly approaches the background limiter, reverses until the limiter goes off, then does the same with the foreground limiter.
+// The two measured backlash values are saved to EEPROM and displayed in the comment line. Any key aborts the measurement.
+// Requires BL_MAP. Don't use BL_MAP_DEBUG together with BL_DEBUG!
+//#define BL_MAP_DEBUG
 // Uncomment this line to measure SHUTTER_ON_DELAY2 (electronic shutter for Canon DSLRs; when mirror_lock=2).
 // When DELAY_DEBUG is defined, two keys get reassigned: keys "2" and "3" become "reduce SHUTTER_ON_DELAY2" and "increase SHUTTER_ON_DELAY2" functions
-// Don't use DELAY_DEBUG together with either BL_DEBUG or BL2_DEBUG!
+// Don't use DELAY_DEBUG together with BL_DEBUG, BL2_DEBUG, SETTLE_DEBUG or SHAPER_DEBUG!
 //#define DELAY_DEBUG
 // Step used durinmg DELAY_DEBUG (in us)
 const long DELAY_STEP = 50000;
+// Uncomment this line to calibrate the constant term of the settle time model (SETTLE_MODEL, see below) for your rig: shoot non-continuous test
+// stacks, and find the smallest value which doesn't produce vibration blur. When SETTLE_DEBUG is defined, two keys get reassigned: keys "2" and "3"
+// become "reduce" and "increase" the constant term (saved to EEPROM right away, and displayed in the position line in 10 ms units).
+// Requires SETTLE_MODEL. Don't use SETTLE_DEBUG together with BL_DEBUG, BL2_DEBUG, DELAY_DEBUG or SHAPER_DEBUG!
+//#define SETTLE_DEBUG
+// Step used during SETTLE_DEBUG (in s)
+const float SETTLE_STEP = 0.05;
+// Uncomment this line to choose the input shaper model (INPUT_SHAPER, see below) for your rig. When SHAPER_DEBUG is defined, two keys get reassigned:
+// keys "2" and "3" select the previous and the next model in the SHAPERS table (saved to EEPROM right away; the model is shown in the comment line,
+// and its number in the position line). Shoot a non-continuous test stack ("#0") with the shortest FIRST_DELAY for each model, and compare the frames:
+// the right model gives sharp frames right after the move. Then save the model to the memory registers (#2 etc.) it should be used with.
+// Requires INPUT_SHAPER. Don't use SHAPER_DEBUG together with BL_DEBUG, BL2_DEBUG, DELAY_DEBUG or SETTLE_DEBUG!
+//#define SHAPER_DEBUG
 // Uncomment to disable shutter triggering:
 //#define DISABLE_SHUTTER
+// Uncomment to display the SRAM usage (bytes) in line 5 of the alternative display ("*"): static RAM (data + bss; the same number the Arduino IDE reports
+// as "Global variables use ..."), the smallest free RAM since startup (stack high-water mark), and the current free RAM (between the heap and the stack).
+//#define RAM_DEBUG
 
 
 //////// Camera related parameters: ////////
@@ -61,6 +224,19 @@ const unsigned long SHUTTER_OFF_DELAY = 5000; // Delay in microseconds between s
 //      for non-continuous stacking (#0); during continuous stacking, AF is permanently on (this can increase the maximum FPS your camera can yield);
 //  1: AF is always synched with shutter, even for continuous stacking. Use this feature only if your camera requires it.
 const short AF_SYNC = 0;
+#ifdef FLASH_SYNC
+// Delay between the flash sync signal and the rail starting to move to the next frame, us. It should cover the rest of the exposure: the flash
+// duration with a flash sensor, or the shutter time if the sync contact closes at the start of a longer (ambient light) exposure:
+const unsigned long FLASH_SYNC_DELAY = 20000;
+// Number of times a shot is retried when there is no flash sync signal within SECOND_DELAY after triggering it:
+const byte FLASH_RETRIES = 2;
+#endif
+#ifdef STOP_AND_GO
+// Largest motion blur (rail travel during one exposure) allowed in continuous stacking, microns:
+constexpr float STOP_AND_GO_BLUR_UM = 1.0;
+// Exposure window, counted from the shutter trigger (shutter lag plus the exposure time), us:
+const unsigned long STOP_AND_GO_EXPOSURE_US = 100000;
+#endif
 #ifdef DELAY_DEBUG
 // Initial values for the two electronic shutter delays during delay debugging:
 // The SHUTTER_ON_DELAY2 value can be modified during debugging (keys 2/3); the SHUTTER_OFF_DELAY2 value is fixed
@@ -82,11 +258,56 @@ const unsigned long SHUTTER_OFF_DELAY2 = 100000;
 #endif
 
 //////// Pin assignment ////////
-// Pin 10 is left unused because it is used internally by hardware SPI.
+// Pin 10 is left unused because it is used internally by hardware SPI (it can only be used as an output; h1.3 uses it for PIN_DIR).
 // We are using the bare minimum of arduino pins for stepper driver:
 const short PIN_STEP = 0;
+#if defined(TELEMETRY) || defined(ENCODER)
+// Hardware h1.3: pin 1 is the UART TX line used by telemetry (h1.6: the encoder channel B), so the direction pin was moved to the (otherwise unused) pin 10:
+const short PIN_DIR = 10;
+#else
 const short PIN_DIR = 1;
+#endif
 const short PIN_ENABLE = 2;  // LOW: enable motor; HIGH: disable motor (to save energy)
+#ifdef MICROSTEP_SWITCH
+// Hardware h1.3m: EasyDriver's MS1 and MS2 pins (wired together); HIGH: N_MICROSTEPS microsteps per step, LOW: full steps
+const short PIN_MS = 10;
+#endif
+#ifdef AXIS2
+// Hardware h1.4: the second (lateral) driver; its ENABLE pin is wired to PIN_ENABLE. Pin 9 is no longer used for the LCD backlight:
+const short PIN_STEP2 = 10;
+const short PIN_DIR2 = 9;
+#endif
+#ifdef FLASH_SYNC
+// Hardware h1.5: the camera's flash sync (PC-sync or hot shoe X contact, or an open collector flash sensor) between pin 9 and the ground (LOW during
+// the exposure); pin 9 is no longer used for the LCD backlight:
+const short PIN_FLASH = 9;
+#endif
+#ifdef ENCODER
+// Hardware h1.6: the motor shaft encoder channels (open collector, or 5V push-pull outputs); pin 9 is no longer used for the LCD backlight.
+// Channel A has the pin change interrupt (both edges are counted, so there are 2*ENCODER_LINES counts per motor rotation), channel B is only read:
+const short PIN_ENC_A = 9;
+const short PIN_ENC_B = 1;
+#endif
+// Pin conflicts of the hardware modifications above:
+#if defined(MICROSTEP_SWITCH) && defined(TELEMETRY)
+#error "MICROSTEP_SWITCH and TELEMETRY can't be used together (both use pin 10)"
+#endif
+#if defined(AXIS2) && (defined(TELEMETRY) || defined(MICROSTEP_SWITCH))
+#error "AXIS2 can't be used together with TELEMETRY or MICROSTEP_SWITCH (pin 10)"
+#endif
+#if defined(FLASH_SYNC) && defined(AXIS2)
+#error "FLASH_SYNC and AXIS2 can't be used together (both use pin 9)"
+#endif
+#if defined(ENCODER) && (defined(TELEMETRY) || defined(MICROSTEP_SWITCH) || defined(AXIS2))
+#error "ENCODER can't be used together with TELEMETRY (pin 1), MICROSTEP_SWITCH (pin 10) or AXIS2 (pins 9, 10)"
+#endif
+#if defined(ENCODER) && defined(FLASH_SYNC)
+#error "ENCODER and FLASH_SYNC can't be used together (both use pin 9 and its pin change interrupt)"
+#endif
+// The shaped motion is made one microstep per loop at most, so it can't drive the full steps of MICROSTEP_SWITCH:
+#if defined(MICROSTEP_SWITCH) && defined(INPUT_SHAPER)
+#error "MICROSTEP_SWITCH and INPUT_SHAPER can't be used together"
+#endif
 // LCD pins (Nokia 5110): following resistor scenario in https://learn.sparkfun.com/tutorials/graphic-lcd-hookup-guide
 const short PIN_LCD_DC = 5;  // Via 10 kOhm resistor
 const short PIN_LCD_LED = 9;  // Via 330 Ohm resistor
@@ -144,60 +365,84 @@ Keypad keypad = Keypad( makeKeymap(keys), rowPins, colPins, rows, cols );
 
 
 //////// Parameters related to the motor and the rail: ////////
-// Number of full steps per rotation for the stepper motor:
-const COORD_TYPE MOTOR_STEPS = 200;
-// Number of microsteps in a step (default for EasyDriver is 8):
-const COORD_TYPE N_MICROSTEPS = 8;
-// Macro rail parameter: travel distance per one rotation, in mm (3.98mm for Velbon Mag Slider):
-const float MM_PER_ROTATION = 3.98;
-// Backlash compensation (in mm); positive direction (towards background) is assumed to be the good one (no BL compensation required);
-// all motions moving in the bad (negative) direction at the end will need some BL compensation.
-// Using the simplest BL model (assumption: rail physically doesn't move until rewinding the full g.backlash amount,
-// and then instantly starts moving; same when moving to the positive direction after moving to the bad direction).
-// The algorithm guarantees that every time the rail comes to rest, it is fully BL compensated (so the code coordinate = physical coordinate).
-// Should be determined experimentally: too small values will produce visible backlash (two or more frames at the start of the stacking
-// sequence will look alsmost identical). For my Velbon Super Mag Slide rail I measured the BL to be ~0.2 mm.
-// Set it to zero to disable BL compensation.
-const float BACKLASH_MM = 0.2; // 0.2mm for Velbon Super Mag Slider
-// This is the second backlash related parameter you need to measure for you rail (or just use the value provided if your rail is Velbon Super Mag Slider)
-// This parameter is only relevant for one operation - rail reversal (*1 function). Unlike the above parameter (BACKLASH_MM) which can be equal to or
-// larger than the actual backlash value for the rail movements to be perfectly accurate, the BACKLASH_2 parameter has to have a specific value (not larger, no smaller); if
-// your rail backlash changes as a function of the rail angle, position on the rail, camera weight etc., BACKLASH_2 would have to change as well.
-// Because it is not practical, your value of BACKLASH_2 should be a compromise, giving reasonable results under normal usage scenario. In any case
-// rail reversal (*1) wasn't meant to be a perfectly accurate operation, whereas the standard backlash compensation is.
-// Use the BL2_DEBUG mode to find the good value of this parameter. You should convert the displayed value of BL2_DEBUG from microsteps
-// to mm, by multiplying by MM_PER_ROTATION/(MOTOR_STEPS*N_MICROSTEPS).
-// Adjust this parameter only after you found a good value for BACKLASH_MM parameter.
-const float BACKLASH_2_MM = 0.3333; // 0.3333mm for Velbom Super Mag Slider
-// Speed limiter, in mm/s. Higher values will result in lower torques and will necessitate larger travel distance
-// between the limiting switches and the physical limits of the rail. In addition, too high values will result
-// in Arduino loop becoming longer than inter-step time interval, which can screw up the algorithm.
-// 5 mm/s seems to be a reasonable compromize, for my motor and rail.
-// For an arbitrary rail and motor, make sure the following condition is met:
-// 10^6 * MM_PER_ROTATION / (MOTOR_STEPS * N_MICROSTEPS * SPEED_LIMIT_MM_S) >~ 500 microseconds
-// This speed limits is normally used only with AC power (which provides mor torque).
-const float SPEED_LIMIT_MM_S = 5;
-// The second (smaller) speed limit (used only with a battery power, which provides less torque):
-const float SPEED_LIMIT2_MM_S = 2.5;
-// Breaking distance (mm) for the rail when stopping while moving at the fastest speed (SPEED_LIMIT)
-// This will determine the maximum acceleration/deceleration allowed for any rail movements - important
-// for reducing the damage to the (mostly plastic) rail gears. Make sure that this distance is smaller
-// than the smaller distance of the two limiting switches (between the switch actuation and the physical rail limits)
-const float BREAKING_DISTANCE_MM = 2.0;
+// The rail and motor specific parameters are in the rail profiles (at the top of this file).
+// Only used with MICROSTEP_SWITCH: above this speed (mm/s) the driver is switched to full steps (outside of stacking). Should be larger than
+// the speeds used for limiter homing and backlash measurement, and large enough for the full steps not to cause vibrations:
+constexpr float MS_SPEED_MM_S = 1.5;
 // Rewind/fast-forward acceleration factor: the acceleration when pressing "1" or "A" keys (rewind / fast forward) will be slower than the ACCEL_LIMIT (see below) by this factor
 // Should be 1 or larger. If 1, we have the old behaviour - acceleration and deceleration are always the same, ACCEL_LIMIT
 // This feature is to allow for more precise positioning of the rail, to find good fore/background points, but keep all other rail movements as fast as possible
 // Set it to a larger value if you typically deal with high magnifications, and a lower value if you do low magnifications.
 //const float ACCEL_FACTOR = 3.0;
-// Padding (in microsteps) for a soft limit, before hitting the limiters:
+#ifdef BL_MAP_DEBUG
+// Speed (mm/s) used to approach the limiters and to back off from them during the backlash measurement. Should be slow enough for the
+// breaking distance to be much smaller than one microstep:
+const float BL_CAL_SPEED_MM_S = 0.1;
+// Differential travel (hysteresis) of the limiting switches, in microsteps. The measurement can only see the sum of the backlash and
+// the switch hysteresis; 0 is the safe choice (the measured backlash will then be slightly overestimated, never underestimated):
+const COORD_TYPE LIMITER_HYSTERESIS = 0;
+// Safety margin (in microsteps) added to each measured backlash value:
+const COORD_TYPE BL_MAP_PAD = 2;
+#endif
+// Padding (in microsteps) for a soft limit, before hitting the limiters. With HOMING (see below) the limiter positions are accurate to
+// the repeatability displayed at the end of calibration, so this (and LIMITER_PAD2) can be reduced to a few times that value.
 const COORD_TYPE LIMITER_PAD = 400;
 // A bit of extra padding (in microsteps) when calculating the breaking distance before hitting the limiters (to account for inaccuracies of go_to()):
 const COORD_TYPE LIMITER_PAD2 = 100;
 const COORD_TYPE DELTA_LIMITER = 1000; // In calibration, after hitting the first limiter, breaking, and moving in the opposite direction,
 // travel this many microsteps after the limiter goes off again, before starting checking the limiter again
+// Two-speed homing parameters (only used with HOMING - see below). After hitting a limiter at full speed during calibration, the rail backs off HOMING_BACKOFF microsteps
+// from the point where the limiter went on (should be larger than the limiter hysteresis + backlash), and then re-approaches the limiter
+// at HOMING_SPEED_MM_S (slow enough for the position where the limiter goes on to be accurate to a microstep). This is repeated N_HOMING times.
+const float HOMING_SPEED_MM_S = 0.25;
+const COORD_TYPE HOMING_BACKOFF = 200;
+const byte N_HOMING = 2;
+#ifdef ACCEL_TUNE
+// Acceleration tuning parameters (only used with ACCEL_TUNE - see above). The accelerations tried, in units of ACCEL_LIMIT/4, in increasing order;
+// ACCEL_TUNE_DEFAULT is the index of ACCEL_LIMIT itself (used until the rail is tuned). The accelerations below ACCEL_LIMIT make the emergency stops
+// longer than BREAKING_DISTANCE_MM (the soft limits take it into account, but a limiter hit needs that much travel beyond the switch):
+const byte N_TUNED_ACCEL = 7;
+const byte TUNED_ACCEL[N_TUNED_ACCEL] PROGMEM = {2, 3, 4, 6, 8, 12, 16};
+const byte ACCEL_TUNE_DEFAULT = 2;
+// Round trips between the soft limits at each acceleration:
+const byte ACCEL_TUNE_MOVES = 2;
+// Largest change of the homed foreground limiter position (microsteps) which is not counted as lost steps (the motor loses whole steps):
+const COORD_TYPE ACCEL_TUNE_TOL = N_MICROSTEPS / 2;
+#endif
+#ifdef AXIS2
+// Second (lateral) axis parameters (only used with AXIS2 - see below). The motor and the driver are of the same kind as for the
+// focusing axis (MOTOR_STEPS, N_MICROSTEPS). The lateral coordinate is 0 at power up, so the lateral rail should be powered up near its
+// foreground end (but at least AXIS2_BACKLASH_MM away from it); AXIS2_TRAVEL_MM is the soft limit from there:
+constexpr float AXIS2_MM_PER_ROTATION = 3.98;
+constexpr float AXIS2_TRAVEL_MM = 60.0;
+// Backward lateral moves overshoot by this much, followed by a short forward move (so every lateral move ends in the positive direction):
+constexpr float AXIS2_BACKLASH_MM = 0.2;
+// The lateral speed has to be low enough for the microstep interval to be at least two loop lengths (checked below):
+constexpr float AXIS2_SPEED_MM_S = 1.2;
+constexpr float AXIS2_BREAKING_DISTANCE_MM = 0.5;
+// Distance between two lateral positions in the job mode (should be smaller than the frame width, for the stacks to overlap):
+constexpr float AXIS2_DY_MM = 10.0;
+#endif
+#ifdef ENCODER
+// Encoder parameters (only used with ENCODER - see above). Number of encoder lines (pulses of each channel) per motor rotation; the number of microsteps
+// per rotation has to be a multiple of 2*ENCODER_LINES (checked below):
+const short ENCODER_LINES = 400;
+// 1, or -1 if the encoder counts backwards (channels A and B swapped):
+const char ENCODER_SIGN = 1;
+// Largest difference between the commanded and the encoder position at the end of a move, in full steps; a larger one is corrected with an extra move:
+constexpr float ENCODER_TOLERANCE_STEPS = 0.5;
+// Difference while moving (in full steps) which means the motor slipped; the rotor lags behind by up to one full step under load, and a slip
+// loses four full steps:
+constexpr float ENCODER_SLIP_STEPS = 3.0;
+// A slip within this time (us) from the previous one means the motor stalled:
+const unsigned long ENCODER_STALL_DT = 100000;
+// Number of correction moves at the end of a move:
+const byte ENCODER_RETRIES = 2;
+#endif
 // Delay in microseconds between LOW and HIGH writes to PIN_STEP (should be >=1 for Easydriver; but arduino only guarantees delay accuracy for >=3)
 const short STEP_LOW_DT = 3;
-// Delay after writing to PIN_ENABLE, ms (only used in SAVE_ENERGY mode):
+// Time for the driver to get ready after it is enabled (PIN_ENABLE going LOW), ms; a move starts that much later (only in the save energy mode,
+// and only if the driver was disabled):
 const short ENABLE_DELAY_MS = 3;
 
 
@@ -206,38 +451,110 @@ const unsigned long COMMENT_DELAY = 1000000; // time in us to keep the comment l
 const unsigned long T_KEY_LAG = 500000; // time in us to keep a parameter change key pressed before it will start repeating
 const unsigned long T_KEY_REPEAT = 200000; // time interval in us for repeating with parameter change keys
 const unsigned long DISPLAY_REFRESH_TIME = 1000000; // time interval in us for refreshing the whole display (only when not moving). Mostly for updating the battery status
+// In non-continuous stacking, the display refresh and the position saving after arriving at a frame are deferred until the rail is waiting to settle
+// (or the exposure is in progress); they are only done if at least this much time (us) is left before the shot (an EEPROM byte takes 3.4 ms to write):
+const unsigned long UPDATE_TIME = 30000;
+
+
+#ifdef TELEMETRY
+//////// Telemetry parameters: ////////
+const unsigned long TELEMETRY_BAUD = 115200; // UART speed (8N1, transmit only)
+// Time interval in us between two telemetry records. One record takes ~2.5 ms to transmit at 115200 baud; if records are generated
+// faster than they can be sent, the TX buffer fills up and the extra records are dropped (loop() never waits for the UART):
+const unsigned long TELEMETRY_DT = 20000;
+// Size of the TX ring buffer in bytes (must be a power of 2, and larger than sizeof(telemetry_record)):
+#define TX_BUF_SIZE 64
+#endif
 
 
 //////// INPUT PARAMETERS: ////////
+// All the tables below are stored in flash memory (PROGMEM), to save SRAM; they are read with the functions in misc.ino (mm_per_frame() etc.)
 // If defined, the smaller values (< 20 microsteps) in the MM_PER_FRAME table below will be rounded off to the nearest whole number of microsteps.
 #define ROUND_OFF
+#ifdef ROUND_OFF
+// Rounding off is done at compile time:
+constexpr float round_off(float mm)
+{
+  return (mm * MOTOR_STEPS * N_MICROSTEPS / MM_PER_ROTATION + 0.5 < 20.0) ?
+         (float)(long)(mm * MOTOR_STEPS * N_MICROSTEPS / MM_PER_ROTATION + 0.5) * (MM_PER_ROTATION / ((float)MOTOR_STEPS * (float)N_MICROSTEPS)) : mm;
+}
+#else
+constexpr float round_off(float mm)
+{
+  return mm;
+}
+#endif
 // Number of values for the input parameters (mm_per_frame etc):
 const short N_PARAMS = 25;
 //  Mm per frame parameter (determined by DoF of the lens)
-float MM_PER_FRAME[] = {0.0025, 0.005, 0.0075, 0.01, 0.015, 0.02, 0.025, 0.03, 0.04, 0.05, 0.06, 0.08, 0.1, 0.15, 0.2, 0.25, 0.3, 0.4, 0.5, 0.6, 0.8, 1, 1.5, 2, 2.5};
+const float MM_PER_FRAME[] PROGMEM = {round_off(0.0025), round_off(0.005), round_off(0.0075), round_off(0.01), round_off(0.015), round_off(0.02), round_off(0.025), round_off(0.03), round_off(0.04), round_off(0.05), round_off(0.06), round_off(0.08), round_off(0.1),
+                                      round_off(0.15), round_off(0.2), round_off(0.25), round_off(0.3), round_off(0.4), round_off(0.5), round_off(0.6), round_off(0.8), round_off(1), round_off(1.5), round_off(2), round_off(2.5)
+                                     };
 // Frame per second parameter (Canon 50D can do up to 4 fps when Live View is not enabled, for 20 shots using 1000x Lexar card):
-const float FPS[] = {0.01, 0.02, 0.03, 0.04, 0.05, 0.06, 0.08, 0.1, 0.15, 0.2, 0.25, 0.3, 0.35, 0.4, 0.5, 0.6, 0.8, 1, 1.2, 1.5, 2, 2.5, 3, 3.5, 4};
+const float FPS[] PROGMEM = {0.01, 0.02, 0.03, 0.04, 0.05, 0.06, 0.08, 0.1, 0.15, 0.2, 0.25, 0.3, 0.35, 0.4, 0.5, 0.6, 0.8, 1, 1.2, 1.5, 2, 2.5, 3, 3.5, 4};
+// If defined, continuous stacking slows down from the camera's burst frame rate to its sustained one once the camera buffer is full (the camera
+// model is selected with "*#", and saved with the memory registers; model 0 means no limits):
+//#define CAMERA_BUFFER
+#ifdef CAMERA_BUFFER
+// The entries other than 0 are examples - replace them with the values measured for your cameras (buffer depth in frames, frames per second):
+struct camera_model
+{
+  byte buffer;
+  float burst_fps;
+  float sustained_fps;
+};
+const byte N_CAMERAS = 4;
+const camera_model CAMERAS[N_CAMERAS] PROGMEM = {{0, 0.0, 0.0}, {30, 4.0, 2.0}, {16, 4.0, 1.0}, {8, 3.0, 0.5}};
+#endif
+// If defined, all the rail moves are input shaped, to suppress the ringing of the rail and camera after the moves: every acceleration change is split
+// into two (ZV shaper) or three (ZVD) smaller steps, half a period of the dominant vibration mode apart, so the vibrations they excite cancel out.
+// The moves end half a period (ZV) or a full period (ZVD) later, but without the ringing, so non-continuous stacking needs a shorter FIRST_DELAY
+// (or settle time, with SETTLE_MODEL). The vibration mode (frequency and damping) is one of the SHAPERS models, measured for your rig (see
+// SHAPER_DEBUG), and saved with the memory registers. The soft limits trip earlier (by the shaper delay times the speed), as the rail lags behind the braking.
+// Don't use INPUT_SHAPER together with MICROSTEP_SWITCH!
+//#define INPUT_SHAPER
+#ifdef INPUT_SHAPER
+// The entries other than 0 are examples - replace them with the values for your rig (type: 1 for ZV, 2 for ZVD; frequency of the dominant vibration
+// mode, Hz; its damping ratio). ZVD tolerates a larger error in the frequency, but the moves take longer:
+struct shaper_model
+{
+  byte type;
+  float f_hz;
+  float zeta;
+};
+const byte N_SHAPERS = 5;
+const shaper_model SHAPERS[N_SHAPERS] PROGMEM = {{0, 0.0, 0.0}, {1, 12.0, 0.05}, {2, 12.0, 0.05}, {1, 20.0, 0.05}, {2, 8.0, 0.1}};
+// Number of the segments of the commanded motion (constant acceleration) remembered by the shaper; they should cover the shaper duration:
+const byte N_SHAPER_SEG = 5;
+#endif
 // Number of shots parameter (to be used in 1-point stacking):
-const short N_SHOTS[] = {2, 3, 4, 5, 6, 8, 10, 12, 15, 20, 25, 30, 40, 50, 75, 100, 125, 150, 175, 200, 250, 300, 400, 500, 600};
+const short N_SHOTS[] PROGMEM = {2, 3, 4, 5, 6, 8, 10, 12, 15, 20, 25, 30, 40, 50, 75, 100, 125, 150, 175, 200, 250, 300, 400, 500, 600};
 // Two delay parameters for the non-continuous stacking mode (initiated with "#0"):
 // The length of the first delay table:
 const short N_FIRST_DELAY = 7;
 // First delay in non-continuous stacking (from the moment rail stops until the shot is initiated), in seconds:
-const float FIRST_DELAY[N_FIRST_DELAY] = {0.5, 1, 1.5, 2, 3, 4, 8};
+const float FIRST_DELAY[N_FIRST_DELAY] PROGMEM = {0.5, 1, 1.5, 2, 3, 4, 8};
 // The length of the first delay table:
 const short N_SECOND_DELAY = 7;
 // Second delay in non-continuous stacking (from the shot initiation until the rail starts moving again), in seconds
 // (This should be always longer than the camera exposure time)
-const float SECOND_DELAY[N_SECOND_DELAY] = {0.5, 1, 1.5, 2, 3, 4, 8};
+const float SECOND_DELAY[N_SECOND_DELAY] PROGMEM = {0.5, 1, 1.5, 2, 3, 4, 8};
 // Table of possible values for accel_factor parameter:
 const byte N_ACCEL_FACTOR = 3;
-const byte ACCEL_FACTOR[N_ACCEL_FACTOR] = {1, 3, 6};
+const byte ACCEL_FACTOR[N_ACCEL_FACTOR] PROGMEM = {1, 3, 6};
 // Table for N_timelapse parameter (number of stacking sequences in the timelapse mode); 1 means no timelapse (just one stack):
 const byte N_N_TIMELAPSE = 7;
-const short N_TIMELAPSE[N_N_TIMELAPSE] = {1, 3, 10, 30, 100, 300, 999};
+const short N_TIMELAPSE[N_N_TIMELAPSE] PROGMEM = {1, 3, 10, 30, 100, 300, 999};
 // Table for dt_timelapse parameter (time in seconds between different stacks in timelapse mode; if it is shorter than a single stack time, the latter is used)
 const byte N_DT_TIMELAPSE = 9;
-const short DT_TIMELAPSE[N_DT_TIMELAPSE] = {1, 3, 10, 30, 100, 300, 1000, 3000, 9999};
+const short DT_TIMELAPSE[N_DT_TIMELAPSE] PROGMEM = {1, 3, 10, 30, 100, 300, 1000, 3000, 9999};
+#ifdef AXIS2
+// Table for the number of lateral positions in the job mode (a full 2-point stack at each position); 1 means no job mode:
+const byte N_N_Y = 8;
+const short N_Y[N_N_Y] PROGMEM = {1, 2, 3, 4, 5, 6, 8, 10};
+#endif
+// Largest number of jobs in the queue (JOB_QUEUE; one EEPROM byte each, reserved in all builds):
+const byte N_JOBS = 16;
 
 
 //////////////////////////////////////////// Normally you shouldn't modify anything below this line ///////////////////////////////////////////////////
@@ -254,36 +571,73 @@ pcd8544 lcd(PIN_LCD_DC, PIN_LCD_RST, PIN_LCD_SCE, PIN_LCD_DN_, PIN_LCD_SCL);
 pcd8544 lcd(PIN_LCD_DC, PIN_LCD_RST, PIN_LCD_SCE);
 #endif
 
+// All the derived motion constants are computed at compile time (from the rail profile):
 // MM per microstep:
-const float MM_PER_MICROSTEP = MM_PER_ROTATION / ((float)MOTOR_STEPS * (float)N_MICROSTEPS);
+constexpr float MM_PER_MICROSTEP = MM_PER_ROTATION / ((float)MOTOR_STEPS * (float)N_MICROSTEPS);
 // Number of microsteps per rotation
-const COORD_TYPE MICROSTEPS_PER_ROTATION = MOTOR_STEPS * N_MICROSTEPS;
+constexpr COORD_TYPE MICROSTEPS_PER_ROTATION = MOTOR_STEPS * N_MICROSTEPS;
 // Breaking distance in internal units (microsteps):
-const float BREAKING_DISTANCE = MICROSTEPS_PER_ROTATION * BREAKING_DISTANCE_MM / (1.0 * MM_PER_ROTATION);
-const float SPEED_SCALE = MICROSTEPS_PER_ROTATION / (1.0e6 * MM_PER_ROTATION); // Conversion factor from mm/s to usteps/usecond
+constexpr float BREAKING_DISTANCE = MICROSTEPS_PER_ROTATION * BREAKING_DISTANCE_MM / (1.0 * MM_PER_ROTATION);
+constexpr float SPEED_SCALE = MICROSTEPS_PER_ROTATION / (1.0e6 * MM_PER_ROTATION); // Conversion factor from mm/s to usteps/usecond
 // Speed limit in internal units (microsteps per microsecond):
-const float SPEED_LIMIT = SPEED_SCALE * SPEED_LIMIT_MM_S;
-const float SPEED_LIMIT2 = SPEED_SCALE * SPEED_LIMIT2_MM_S;
+constexpr float SPEED_LIMIT = SPEED_SCALE * SPEED_LIMIT_MM_S;
+constexpr float SPEED_LIMIT2 = SPEED_SCALE * SPEED_LIMIT2_MM_S;
+// Shortest time interval between two microsteps (at SPEED_LIMIT), in microseconds. With MICROSTEP_SWITCH the microsteps are still made at SPEED_LIMIT
+// while stacking (and when calibrating without HOMING):
+constexpr unsigned short STEP_DT_MIN = (unsigned short)(1.0 / SPEED_LIMIT);
+// The Arduino loop (~250 us on average when moving, up to ~600 us) has to be mostly shorter than STEP_DT_MIN. My rail runs at 497 us, hence the 10% tolerance:
+static_assert(STEP_DT_MIN >= 450, "Microstep interval is too short (should be at least 450 us): reduce SPEED_LIMIT_MM_S");
+#ifdef MICROSTEP_SWITCH
+constexpr float MS_SPEED = SPEED_SCALE * MS_SPEED_MM_S;
+// Shortest time interval between two full steps (fast travel at SPEED_LIMIT), in microseconds:
+constexpr unsigned short FULL_STEP_DT_MIN = (unsigned short)(N_MICROSTEPS / SPEED_LIMIT);
+static_assert(FULL_STEP_DT_MIN >= 450, "Full step interval is too short (should be at least 450 us): reduce SPEED_LIMIT_MM_S");
+#endif
 // Maximum acceleration/deceleration allowed, in microsteps per microseconds^2 (a float)
 // (This is a limiter, to minimize damage to the rail and motor)
-const float ACCEL_LIMIT = SPEED_LIMIT * SPEED_LIMIT / (2.0 * BREAKING_DISTANCE);
+constexpr float ACCEL_LIMIT = SPEED_LIMIT * SPEED_LIMIT / (2.0 * BREAKING_DISTANCE);
+// Breaking distance (microsteps) at the maximum deceleration is BREAKING_FACTOR * speed^2 (a multiplication instead of a float division in the loop):
+constexpr float BREAKING_FACTOR = 0.5 / ACCEL_LIMIT;
 // Speed small enough to allow instant stopping (such that stopping within one microstep is withing ACCEL_LIMIT):
 // 2* - to make goto accurate, but with higher decelerations at the end
 // Currently not used
 const float SPEED_SMALL = 2 * sqrt(2.0 * ACCEL_LIMIT);
 // A small float (to detect zero speed):
-const float SPEED_TINY = 1e-4 * SPEED_LIMIT;
+constexpr float SPEED_TINY = 1e-4 * SPEED_LIMIT;
 // Backlash in microsteps (+0.5 for proper round-off):
-const COORD_TYPE BACKLASH = (COORD_TYPE)(BACKLASH_MM / MM_PER_MICROSTEP + 0.5);
+constexpr COORD_TYPE BACKLASH = (COORD_TYPE)(BACKLASH_MM / MM_PER_MICROSTEP + 0.5);
 #ifdef BL2_DEBUG
 // Initial value for BACKLASH_2:
 COORD_TYPE BACKLASH_2 = (COORD_TYPE)(BACKLASH_2_MM / MM_PER_MICROSTEP + 0.5);
 #else
 // Backlash correction for rail reversal (*1) in microsteps:
-const COORD_TYPE BACKLASH_2 = (COORD_TYPE)(BACKLASH_2_MM / MM_PER_MICROSTEP + 0.5);
+constexpr COORD_TYPE BACKLASH_2 = (COORD_TYPE)(BACKLASH_2_MM / MM_PER_MICROSTEP + 0.5);
+#endif
+#ifdef AXIS2
+// Lateral axis, in microsteps and microseconds:
+constexpr float AXIS2_MICROSTEPS_PER_MM = MOTOR_STEPS * N_MICROSTEPS / AXIS2_MM_PER_ROTATION;
+constexpr float AXIS2_SPEED = 1e-6 * AXIS2_MICROSTEPS_PER_MM * AXIS2_SPEED_MM_S;
+constexpr float AXIS2_ACCEL = AXIS2_SPEED * AXIS2_SPEED / (2.0 * AXIS2_MICROSTEPS_PER_MM * AXIS2_BREAKING_DISTANCE_MM);
+constexpr long AXIS2_LIMIT = (long)(AXIS2_TRAVEL_MM * AXIS2_MICROSTEPS_PER_MM);
+constexpr long AXIS2_BACKLASH = (long)(AXIS2_BACKLASH_MM * AXIS2_MICROSTEPS_PER_MM + 0.5);
+constexpr long AXIS2_DY = (long)(AXIS2_DY_MM * AXIS2_MICROSTEPS_PER_MM + 0.5);
+// The lateral motor is only serviced in the loops when the focusing motor doesn't make a step, so it needs at least two loops per microstep:
+static_assert(1.0 / AXIS2_SPEED >= 2 * STEP_DT_MIN, "Lateral microstep interval is too short: reduce AXIS2_SPEED_MM_S");
+#endif
+#ifdef ENCODER
+// Microsteps per encoder count, and the two thresholds in microsteps (including one count of the encoder resolution):
+constexpr COORD_TYPE ENCODER_MSTEPS = MICROSTEPS_PER_ROTATION / (2 * ENCODER_LINES);
+static_assert(ENCODER_MSTEPS * 2 * ENCODER_LINES == MICROSTEPS_PER_ROTATION, "Microsteps per rotation should be a multiple of 2*ENCODER_LINES");
+constexpr COORD_TYPE ENCODER_TOLERANCE = (COORD_TYPE)(ENCODER_TOLERANCE_STEPS * N_MICROSTEPS + 0.5) + ENCODER_MSTEPS;
+constexpr COORD_TYPE ENCODER_SLIP = (COORD_TYPE)(ENCODER_SLIP_STEPS * N_MICROSTEPS + 0.5) + ENCODER_MSTEPS;
+#endif
+#ifdef STOP_AND_GO
+// Rail speed during the exposures, microsteps per microsecond:
+constexpr float STOP_AND_GO_SPEED = SPEED_SCALE * 1e3 * STOP_AND_GO_BLUR_UM / (float)STOP_AND_GO_EXPOSURE_US;
+static_assert(STOP_AND_GO_SPEED > SPEED_TINY, "STOP_AND_GO_BLUR_UM is too small");
 #endif
 // Maximum FPS possible (depends on various delay parameters above; the additional factor of 2000 us is to account for a few Arduino loops):
-const float MAXIMUM_FPS = 1e6 / (float)(SHUTTER_TIME_US + SHUTTER_ON_DELAY + SHUTTER_OFF_DELAY + 2000);
+constexpr float MAXIMUM_FPS = 1e6 / (float)(SHUTTER_TIME_US + SHUTTER_ON_DELAY + SHUTTER_OFF_DELAY + 2000);
 // If defined, will be using my module to make sure that my physical microsteps always correspond to the program coordinates
 // (this is needed to fix the problem when some Arduino loops are longer than the time interval between microsteps, which results in skipped steps)
 // My solution: every time we detect a skipped microstep in motor_control, we backtrack a bit in time (by modifying variable g.dt_backlash) until the
@@ -291,11 +645,69 @@ const float MAXIMUM_FPS = 1e6 / (float)(SHUTTER_TIME_US + SHUTTER_ON_DELAY + SHU
 // this will keep increasing the time lag. As a result, my rail position will always be precise, but my timings might get slightly behind, and my actual
 // speed might get slightly lower than what program thinks it is.
 #define PRECISE_STEPPING
+// If defined, the time used by the sketch (the equation of motion, camera and display timings) comes from Timer1 (prescaler 8, 0.5 us ticks, and an
+// overflow interrupt), with 1 us resolution, instead of micros() with its 4 us resolution, which shows up as the step timing jitter at high speeds.
+// Timer1 can't be used for PWM then (analogWrite() to pins 9 and 10 is only possible with the values 0 and 255). See clock.ino.
+//#define TIMER1_CLOCK
 // Only matters if BACKLASH is non-zero. If defined, pressing the rewind key ("1") for a certain length of time will result in the travel by the same
 // amount as when pressing fast-forward ("A") for the same period of time, with proper backlash compensation. This should result in smoother user experience.
 // If undefined, to rewind by the same amount,
 // one would have to press the rewind key longer (compared to pressing fast-forward key), to account for backlash compensation.
 #define EXTENDED_REWIND
+// If defined, the backlash used for compensation depends on the rail position: it is interpolated between the values measured at the foreground
+// (g.limit1) and background (g.limit2) limiters, which are the only rail positions with a physical reference. The values are measured with
+// BL_MAP_DEBUG and stored in EEPROM; until then (or after a factory reset) both are equal to BACKLASH, which reproduces the constant backlash behaviour.
+// Don't use BL_MAP together with BL_DEBUG!
+#define BL_MAP
+// If defined, each limiter hit during calibration (#C, or an emergency one-limiter calibration) is followed by a two-speed homing: a short
+// back-off and a slow re-approach, which latches the limiter position independently of the full speed approach and loop timing.
+// The repeatability of the slow approaches (in microsteps) for the foreground (F) and background (B) limiters is displayed at the end of calibration.
+#define HOMING
+// If defined, the limiter input is also monitored by the pin change interrupt, which latches the rail position at the moment the limiter goes on
+// (instead of the position at the time limiters() gets to poll the input), and emergency breaking starts before the next microstep is made.
+// Requires PIN_LIMITERS = 8 (PCINT0). Don't use LIMITER_INT together with other code using the PCINT0_vect interrupt!
+#define LIMITER_INT
+// If defined, the MCU sleeps (idle sleep mode) when the rail is at rest and nothing is going on (no keys pressed, camera not triggered; this includes
+// the waits between the stacks in a timelapse), until a key is pressed, a limiter changes state, or the next timed event (display refresh, comment line
+// timeout, next timelapse stack, telemetry record) is due. Timer0 (and Timer1) keep running, so the time is not affected.
+// The fraction of time the MCU was awake and the estimated current are displayed in line 5 of the alternative display ("*"), unless RAM_DEBUG is used.
+#define IDLE_SLEEP
+// If defined, the delay between the end of a move and the shot in non-continuous stacking ("#0") depends on the move: the time for the rail vibrations
+// to settle is computed from the move length, its peak speed, and whether the move ended with a backlash compensation leg; with mirror lock, it is at
+// least the time for the mirror vibrations to settle. FIRST_DELAY becomes the upper limit. The model coefficients are stored in EEPROM (a factory reset
+// writes SETTLE_DEFAULT); the constant term can be calibrated with SETTLE_DEBUG.
+#define SETTLE_MODEL
+// The settle time model coefficients (SETTLE_MODEL):
+struct settle_coeffs
+{
+  float t0; // Constant term, s
+  float k_d; // Per mm of the move length, s/mm
+  float k_v; // Per mm/s of the peak speed, s/(mm/s)
+  float t_bl; // Added when the move ended with a backlash compensation leg (direction reversal), s
+  float t_mirror; // Smallest delay after the mirror lock-up (mirror_lock=1), s
+};
+#ifdef SETTLE_MODEL
+const settle_coeffs SETTLE_DEFAULT = {0.2, 0.1, 0.1, 0.3, 0.5};
+#endif
+#ifdef IDLE_SLEEP
+// Current drawn by the control unit (motor disabled, no LCD backlight) with the MCU awake and in the idle sleep mode, mA (used for the current estimate):
+const float I_AWAKE_MA = 45.0;
+const float I_SLEEP_MA = 36.0;
+#endif
+#ifdef BL_MAP
+// Number of backlash map nodes (one per limiter):
+const byte N_BL_MAP = 2;
+#endif
+// The options using the "*#" key (only one of them can be used):
+#if defined(AXIS2) + defined(BL_MAP_DEBUG) + defined(CAMERA_BUFFER) + defined(JOB_QUEUE) > 1
+#error "Only one of AXIS2, BL_MAP_DEBUG, CAMERA_BUFFER and JOB_QUEUE can be used (they share the *# key)"
+#endif
+#if defined(ACCEL_TUNE) && !defined(HOMING)
+#error "ACCEL_TUNE requires HOMING"
+#endif
+#if defined(ACCEL_TUNE) && defined(ENCODER)
+#error "Don't use ACCEL_TUNE together with ENCODER (the encoder corrects the slips the tuning is looking for)"
+#endif
 
 
 // Structure to have custom parameters saved to EEPROM
@@ -317,11 +729,22 @@ struct regist
   COORD_TYPE point2;
 };
   // Just in case adding a 1-byte if SIZE_REG is odd, to make the total regist size even (I suspect EEPROM wants data to have even number of bytes):
-short SIZE_REG = sizeof(regist);
+const short SIZE_REG = sizeof(regist);
 
 const short dA = sizeof(COORD_TYPE);
 
+// The state of the rail at rest, for the fast startup (FAST_STARTUP):
+struct boot_record
+{
+  float pos; // g.pos (g.BL_counter is 0)
+  COORD_TYPE limit1; // g.limit1
+  COORD_TYPE limit2; // g.limit2
+  byte checksum; // Sum of all the previous bytes (modulo 256)
+};
+
 // EEPROM addresses: make sure they don't go beyong the Arduino Uno EEPROM size of 1024!
+// The map is the same in all builds (the structures above are defined even when their option is off), and new blocks only go at its end, so the
+// data saved by older builds keeps loading:
 const int ADDR_POS = 0;  // Current position (float, 4 bytes)
 const int ADDR_CALIBRATE = ADDR_POS + 4; // If =3, full limiter calibration will be done at the beginning (1 byte)
 //!!! For some reason +1 doesn't work here, but +2 does, depsite the fact that the previous variable is 1-byte long:
@@ -347,17 +770,69 @@ const int ADDR_BACKLASH_ON = ADDR_MIRROR_LOCK + 2; // for g.backlash_on
 const int ADDR_I_ACCEL_FACTOR = ADDR_BACKLASH_ON + 2; // for g.i_accel_factor
 const int ADDR_I_N_TIMELAPSE = ADDR_I_ACCEL_FACTOR + 2; // for g.i_n_timelaspe
 const int ADDR_I_DT_TIMELAPSE = ADDR_I_N_TIMELAPSE + 2; // for g.i_dt_timelaspe
+const int ADDR_BL_MAP = ADDR_I_DT_TIMELAPSE + 2; // backlash map (N_BL_MAP values of COORD_TYPE)
+const int ADDR_I_N_Y = ADDR_BL_MAP + 2 * dA; // for g.i_n_y
+const int ADDR_I_CAMERA = ADDR_I_N_Y + 2; // for g.i_camera
+// g.i_camera for the five memory registers (kept outside of the regist structure, so the older registers stay readable; 1 byte each):
+const int ADDR_I_CAMERA_REG = ADDR_I_CAMERA + 2;
+const int ADDR_SETTLE = ADDR_I_CAMERA_REG + 5; // settle time model coefficients (struct settle_coeffs)
+const int ADDR_JOB_N = ADDR_SETTLE + sizeof(settle_coeffs);  // number of jobs in the queue (g.job_n)
+const int ADDR_JOB_I = ADDR_JOB_N + 2;  // current job (g.job_i; =g.job_n when the queue is done)
+const int ADDR_JOB_DONE = ADDR_JOB_I + 2;  // stacks done in the current job (short)
+const int ADDR_JOBS = ADDR_JOB_DONE + 2;  // the queue (N_JOBS bytes): memory bank 1...5 in bits 0-6, continuous mode in bit 7
+const int ADDR_I_SHAPER = ADDR_JOBS + N_JOBS;  // for g.i_shaper
+// g.i_shaper for the five memory registers (1 byte each):
+const int ADDR_I_SHAPER_REG = ADDR_I_SHAPER + 2;
+const int ADDR_BOOT = ADDR_I_SHAPER_REG + 5;  // the boot record (struct boot_record)
+// The flag saved after the record: =1 when the rail is at rest since the record was saved; cleared when the rail starts moving:
+const int ADDR_BOOT_CLEAN = ADDR_BOOT + sizeof(boot_record);
+const int ADDR_I_ACCEL_TUNE = ADDR_BOOT_CLEAN + 2;  // for g.i_accel_tune
+// g.i_accel_tune for the five memory registers (1 byte each):
+const int ADDR_I_ACCEL_TUNE_REG = ADDR_I_ACCEL_TUNE + 2;
+static_assert(ADDR_I_ACCEL_TUNE_REG + 5 <= 1024, "EEPROM addresses go beyond the 1024 bytes of the Arduino Uno EEPROM");
+
+#ifdef TELEMETRY
+// One telemetry sample, sent as is (little-endian, no padding on AVR) over the UART:
+struct telemetry_record
+{
+  byte sync[2]; // Always 0xA5, 0x5A (to find the record boundaries in the stream)
+  unsigned long t; // g.t, us
+  float pos; // g.pos, microsteps
+  float speed; // g.speed, microsteps per us
+  char accel; // g.accel
+  byte stacker_mode; // g.stacker_mode
+  short frame_counter; // g.frame_counter
+  unsigned short V; // Last measured voltage per AA battery, mV
+  unsigned short skipped_steps; // Total number of skipped-step corrections (PRECISE_STEPPING) since power up
+  unsigned short dt_max; // Longest loop (us) since the previous record, only counting loops while moving
+  unsigned short bad_timing_counter; // Loops (while moving) longer than the shortest microstep interval, since the previous record
+  byte flags; // bit 0: moving; 1: AF_on; 2: shutter_on; 3: breaking; 4: backlashing; 5: paused; 6: reverse pass (SERPENTINE)
+  byte dropped; // Number of records dropped so far because of a full TX buffer (wraps around)
+  byte checksum; // Sum of all the previous bytes, excluding sync (modulo 256)
+};
+#endif
 
 // 2-char bitmaps to display the battery status; 4 levels: 0 for empty, 3 for full:
-const uint8_t battery_char [][12] = {
+const uint8_t battery_char [][12] PROGMEM = {
   {0xfe, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0xfe, 0x38}, // level 0 (empty)
   {0xfe, 0x82, 0xba, 0xb2, 0xa2, 0x82, 0x82, 0x82, 0x82, 0x82, 0xfe, 0x38}, // level 1 (1/3 charge)
   {0xfe, 0x82, 0xba, 0xba, 0xba, 0xba, 0xb2, 0xa2, 0x82, 0x82, 0xfe, 0x38}, // level 2 (2/3 charge)
   {0xfe, 0x82, 0xba, 0xba, 0xba, 0xba, 0xba, 0xba, 0xba, 0x82, 0xfe, 0x38}  // level 3 (full charge)
 };
 // 2-char bitmaps to display rewind/fast-forward symbols:
-const uint8_t rewind_char[] = {0x10, 0x38, 0x54, 0x92, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00};
-const uint8_t forward_char[] = {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x92, 0x54, 0x38, 0x10, 0x00};
+const uint8_t rewind_char[] PROGMEM = {0x10, 0x38, 0x54, 0x92, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00};
+const uint8_t forward_char[] PROGMEM = {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x92, 0x54, 0x38, 0x10, 0x00};
+
+#ifdef INPUT_SHAPER
+// One segment of the commanded motion (the input of the shaper): constant acceleration index since t0:
+struct shaper_segment
+{
+  unsigned long t0;
+  float pos0;
+  float speed0;
+  char accel;
+};
+#endif
 
 // All global variables belong to one structure - global:
 struct global
@@ -371,6 +846,11 @@ struct global
   
   byte i_accel_factor; // Index for accel_factor  
   float accel_v[5]; // Five possible floating point values for acceleration
+#ifdef ACCEL_TUNE
+  byte i_accel_tune; // Index for the TUNED_ACCEL table (the acceleration tuned for the payload)
+  float accel_limit; // The tuned acceleration, microsteps/us^2 (replaces ACCEL_LIMIT)
+  float breaking_factor; // 0.5 / accel_limit (replaces BREAKING_FACTOR)
+#endif
   float pos;  // Current position (in microsteps). Should be stored in EEPROM before turning the controller off, and read from there when turned on
   float pos_old; // Last position, in the previous arduino loop
   COORD_TYPE pos_short_old;  // Previously computed position
@@ -381,6 +861,8 @@ struct global
   float pos_stop; // Current stop position if breaked
   float pos_stop_old; // Previously computed stop position if breaked
   COORD_TYPE pos_limiter_off; // Position when after hitting a limiter, breaking, and moving in the opposite direction the limiter goes off
+  COORD_TYPE soft_limit1; // Soft limit trip points for the current move (see soft_limits()); the accurate breaking test is only done beyond them
+  COORD_TYPE soft_limit2;
   unsigned long t_key_pressed; // Last time when a key was pressed
   unsigned long int t_last_repeat; // Last time when a key was repeated (for parameter change keys)
   short N_repeats; // Counter of key repeats
@@ -389,15 +871,11 @@ struct global
   unsigned char calibrate_init; // Initial value of g.calibrate (matters only for the first calibration, calibrate=3)
   unsigned char calibrate_flag; // a flag for each leg of calibration: 0: no calibration; 1: breaking after hitting a limiter; 2: moving in the opposite direction (limiter still on);
   // 3: still moving, limiter off; 4: hit the second limiter; 5: rewinding to a safe area
-  unsigned char calibrate_warning; // 1: pause calibration until any key is pressed, and display a warning
   COORD_TYPE limit1; // pos_short for the foreground limiter
   COORD_TYPE limit2; // pos_short for the background limiter
   COORD_TYPE limit_tmp; // temporary value of a new limit when rail hits a limiter
-  unsigned char breaking;  // =1 when doing emergency breaking (e.g. to avoid hitting the limiting switch); disables the keypad
-  unsigned char travel_flag; // =1 when travel was initiated
   float pos_goto; // position to go to
   byte moving_mode; // =0 when using speed_change, =1 when using go_to
-  byte pos_stop_flag; // flag to detect when motor_control is run first time
   char key_old;  // peviously pressed key; used in keypad()
   COORD_TYPE point1;  // foreground point for 2-point focus stacking
   COORD_TYPE point2;  // background point for 2-point focus stacking
@@ -408,9 +886,6 @@ struct global
   short Nframes; // Number of frames for 2-point focus stacking
   short frame_counter; // Counter for shots
   COORD_TYPE pos_to_shoot; // Position to shoot the next shot during focus stacking
-  byte shutter_on; // flag for camera shutter state: 0/1 corresponds to off/on
-  byte AF_on; // flag for camera AF state: 0/1 corresponds to off/on
-  byte single_shot; // flag for a single shot (made with #7): =1 when the shot is in progress, 0 otherwise
   unsigned long t_shutter; // Time when the camera shutter was triggered
   unsigned long t_shutter_off; // Time when the camera shutter was switched off
   unsigned long t_AF; // Time when the camera AF was triggered
@@ -424,52 +899,179 @@ struct global
   char direction; // -1/1 for reverse/forward directions of moving
   char buffer[15];  // char buffer to be used for lcd print; 1 more element than the lcd width (14)
   unsigned long t_comment; // time when commment line was triggered
-  byte comment_flag; // flag used to trigger the comment line briefly
   byte error; // error code (no error if 0); 1: initial limiter on or cable disconnected; 2: battery drained; non-zero value will disable the rail (with some exceptions)
   byte backlight; // backlight level; 0,1 for now
   struct regist reg; // Custom parameters register
   COORD_TYPE coords_change; // if >0, coordinates have to change (because we hit limit1, so we should set limit1=0 at some point)
   byte start_stacking; // =1 if we just initiated focus stacking, =2 when AF is triggered initially, =3 after CONT_STACKING_DELAY delay in continuous mode, =0 when no stacking
-  byte make_shot; // =1 if we just initiated a shot; 0 otherwise
   unsigned long t_shot; // the time shot was initiated
   unsigned long int t0_stacking; // time when stacking was initiated;
   byte paused; // =1 when 2-point stacking was paused, after hitting any key; =0 otherwise
   COORD_TYPE BL_counter; // Counting microsteps made in the bad (negative) direction. Possible values 0...BACKLASH. Each step in the good (+) direction decreases it by 1.
-  byte started_moving; // =1 when we just started moving (the first loop), 0 otherwise
-  byte backlashing; // A flag to ensure that backlash compensation is uniterrupted (except for emergency breaking, #B); =1 when BL compensation is being done, 0 otherwise
-  byte continuous_mode; // 2-point stacking mode: =0 for a non-continuous mode, =1 for a continuous mode
   byte noncont_flag; // flag for non-continuous mode of stacking; 0: no stacking; 1: initiated; 2: first shutter trigger; 3: second shutter; 4: go to the next frame
   unsigned long t_old;
   float speed_limit = SPEED_LIMIT;  // Current speed limit, in internal units. Determined once, when the device is powered up
-  byte setup_flag; // Flag used to detect if we are in the setup section (then the value is 1; otherwise 0)
-  byte alt_flag; // 0: normal display; 1: alternative display (when pressing *)
   byte straight;  // 0: reversed rail (PIN_DIR=LOW is positive); 1: straight rail (PIN_DIR=HIGH is positive)
-  char* rev_char; // "R" if rail revered, " " otherwise
+  const char* rev_char; // "R" if rail revered, " " otherwise
   byte backlash_init; // 1: initializing a full backlash loop; 2: initializing a rail reverse
   byte mirror_lock; // 1: mirror lock is used in non-continuous stacking; 0: not used; 2: similar to 0, but using SHUTTER_ON_DELAY2, SHUTTER_OFF_DELAY2 instead of SHUTTER_ON_DELAY, SHUTTER_OFF_DELAY
-  byte disable_limiters; // 1: to temporarily disable limiters (not saved to EEPROM)
   char buf6[6]; // Buffer to store the stacking length for displaying
   char buf7[7];
   short timelapse_counter; // Counter for the time lapse feature
   unsigned long t_mil; // millisecond accuracy timer; used to set up timelapse stacks
   unsigned long t0_mil; // millisecond accuracy timer; used to set up timelapse stacks
-  byte end_of_stacking; // =1 when we are done with stacking (might still be moving, in continuoius mode)  
-  byte timelapse_mode; // =1 during timelapse mode, 0 otherwise
-  COORD_TYPE backlash; // current value of backlash in microsteps (can be either 0 or BACKLASH)
+  COORD_TYPE backlash; // current value of backlash in microsteps (can be either 1 or BACKLASH; with BL_MAP, the local value at the current travel target)
   byte backlash_on; // =1 when g.backlash=BACKLASH; =0 when g.backlash=0.0
   byte save_energy; // =0: always using the motor's torque, even when not moving (should improve accuracy and holding torque); =1: save energy (only use torque during movements)
+  // One bit flags (0/1 values only), packed into bitfields to save SRAM. Don't use them with EEPROM.get() or & (no address):
+  byte breaking : 1; // =1 when doing emergency breaking (e.g. to avoid hitting the limiting switch); disables the keypad
+  byte shutter_on : 1; // flag for camera shutter state: 0/1 corresponds to off/on
+  byte AF_on : 1; // flag for camera AF state: 0/1 corresponds to off/on
+  byte single_shot : 1; // flag for a single shot (made with #7): =1 when the shot is in progress, 0 otherwise
+  byte make_shot : 1; // =1 if we just initiated a shot; 0 otherwise
+  byte started_moving : 1; // =1 when we just started moving (the first loop), 0 otherwise
+  byte backlashing : 1; // A flag to ensure that backlash compensation is uniterrupted (except for emergency breaking, #B); =1 when BL compensation is being done, 0 otherwise
+  byte continuous_mode : 1; // 2-point stacking mode: =0 for a non-continuous mode, =1 for a continuous mode
+  byte setup_flag : 1; // Flag used to detect if we are in the setup section (then the value is 1; otherwise 0)
+  byte alt_flag : 1; // 0: normal display; 1: alternative display (when pressing *)
+  byte disable_limiters : 1; // 1: to temporarily disable limiters (not saved to EEPROM)
+  byte end_of_stacking : 1; // =1 when we are done with stacking (might still be moving, in continuoius mode)
+  byte timelapse_mode : 1; // =1 during timelapse mode, 0 otherwise
+  byte comment_flag : 1; // flag used to trigger the comment line briefly
+  byte pos_stop_flag : 1; // flag to detect when motor_control is run first time
+  byte calibrate_warning : 1; // 1: pause calibration until any key is pressed, and display a warning
+  byte update_pending : 1; // =1 when stop_now() deferred the display refresh, the position saving and the coordinate recalibration
 #ifdef PRECISE_STEPPING
   unsigned long dt_backlash;
+#endif
+  byte driver_state; // Motor driver: 0: disabled; 1: enabled, getting ready (until ENABLE_DELAY_MS after g.t_enable); 2: ready
+  unsigned long t_enable; // Time when the driver was enabled
+#ifdef TIMER1_CLOCK
+  volatile unsigned long t1_ovf; // Timer1 overflows since clock_init() (changed by the overflow interrupt)
 #endif
 #ifdef EXTENDED_REWIND
   byte no_extended_rewind;
 #endif
-#ifdef TIMING
-  unsigned long i_timing;
-  unsigned long t0_timing;
-  short dt_max;
-  short dt_min;
-  short bad_timing_counter; // How many loops in the last movement were longer than the shortest microstep interval allowed
+#ifdef BL_MAP
+  COORD_TYPE bl_map[N_BL_MAP]; // Backlash (microsteps) at g.limit1 and g.limit2, for the straight (g.straight=1) rail
+#endif
+#ifdef HOMING
+  byte homing_flag; // 0: no homing; 1: backing off; 2: backed off, start slow approach; 3: slow approach; 4: latched, stopping; 5: done (g.limit_tmp updated)
+  char homing_dir; // Direction towards the limiter being homed: 1 for the background, -1 for the foreground limiter
+  byte homing_i; // Counter of slow approaches
+  COORD_TYPE homing_start; // Position where the current slow approach started
+  COORD_TYPE homing_pos[N_HOMING]; // Positions where the limiter went on during slow approaches
+  COORD_TYPE homing_rep[2]; // Repeatability (largest spread of homing_pos) for the foreground and background limiters, in microsteps
+  byte homing_report; // =1 when the repeatability has to be displayed at the end of calibration
+#endif
+#ifdef MICROSTEP_SWITCH
+  byte ms_coarse; // =1 when the driver makes full steps (PIN_MS is LOW)
+  byte ms_phase; // Driver position within a full step, in microsteps (0 at full step positions)
+#endif
+#ifdef AXIS2
+  byte y_moving; // Lateral axis: 0: at rest; 1: moving backwards (overshooting by AXIS2_BACKLASH); 2: moving forward to the target
+  long y_short_old; // Current lateral position, microsteps (0 at power up)
+  long y0; // Lateral position at the start of the current leg
+  long y_target; // Final target of the current lateral move
+  char y_dir; // Direction of the current leg: 1 or -1
+  float y_dist; // Length of the current leg, microsteps
+  float y_ta; // Duration of the acceleration (and of the deceleration) in the current leg, us
+  float y_tc; // Time (since the start of the leg) when the deceleration starts, us
+  float y_v; // Cruise speed of the current leg, microsteps per us
+  unsigned long t_y0; // Time when the current leg started
+  byte i_n_y; // Index for the N_Y table (number of lateral positions in the job mode)
+  short y_counter; // Job mode: counter of lateral positions (0 ... n_y()-1)
+  long y_start; // Job mode: lateral position of the first stack
+#endif
+#ifdef LIMITER_INT
+  volatile byte limit_hit; // =1 when the limiter interrupt latched a new limiter hit, not yet processed in limiters()
+  volatile COORD_TYPE limit_hit_pos; // Rail position (g.pos_short_old) at the moment the limiter went on
+#endif
+#ifdef BL_MAP_DEBUG
+  byte bl_cal_flag; // Backlash measurement: 0: off; 1: start travelling to the limiter side; 2: travelling; 3: approaching the limiter; 4: backing off; 5: breaking; 6: back to safe area
+  char bl_cal_side; // 1: measuring at the background limiter; -1: at the foreground limiter
+  COORD_TYPE bl_cal_start; // Position where the slow approach started
+  COORD_TYPE bl_cal_on; // Position where the limiter went on
+  COORD_TYPE bl_cal_value; // Measured backlash (plus switch hysteresis) for the current side
+#endif
+#ifdef ACCEL_TUNE
+  byte tune_flag; // Acceleration tuning: 0: off; 1: start moving to the foreground limiter; 2: moving; 3: stopped there, homing; 4: back to safe area; 5: test moves; 6: aborted; 7: waiting for the full calibration
+  byte tune_i; // Index (TUNED_ACCEL) of the acceleration being tested
+  byte tune_best; // Largest acceleration tested without lost steps (N_TUNED_ACCEL: none yet)
+  byte tune_n; // Test moves made at the current acceleration
+  COORD_TYPE tune_ref; // Foreground limiter position found before the test moves
+#endif
+#ifdef SETTLE_MODEL
+  COORD_TYPE pos_start; // Position where the current move (or leg) started
+  float t_settle; // Time needed for the rail to settle after the last move, s
+#endif
+#ifdef FLASH_SYNC
+  volatile byte flash; // 0: not waiting for the flash sync signal; 1: waiting (the shot was initiated); 2: the signal was latched by the interrupt
+  volatile unsigned long t_flash; // Time when the flash sync signal was latched
+  byte flash_retries; // Number of retries for the current frame
+  short flash_n; // Statistics for the current non-continuous stack: number of shots confirmed by the flash sync signal,
+  short flash_missed; // number of missed shots,
+  unsigned long flash_sum; // sum and
+  unsigned long flash_max; // maximum of the shutter-to-flash latencies, us
+#endif
+#ifdef ENCODER
+  volatile long enc_count; // Encoder counts since encoder_sync() (changed by the pin change interrupt)
+  volatile byte enc_a; // Last state of the encoder channel A
+  COORD_TYPE enc_offset; // Rail position at enc_count=0
+  byte enc_flag; // 0: nothing to do; 1: a move ended, the position has to be verified; 2: the motor stalled (only following the encoder at the end)
+  byte enc_retries; // Correction moves made for the current target
+  COORD_TYPE enc_lost; // Microsteps corrected since the last report
+  unsigned long t_slip; // Time of the last slip correction while moving
+#endif
+#ifdef JOB_QUEUE
+  byte job_mode; // 0: off; 1: recording; 2: running a job; 3: the next job was loaded, waiting for the rail to be at rest; 4: waiting before the next job
+  byte job_n; // Number of jobs in the queue
+  byte job_i; // Current job (0 ... job_n-1)
+  byte job_bank; // Memory bank read or saved last (0: none since the recording started)
+#endif
+#ifdef INPUT_SHAPER
+  byte i_shaper; // Index for the SHAPERS table (input shaper model)
+  byte sh_n; // Number of the shaper impulses (1: no shaping)
+  float sh_a[3]; // Amplitudes of the impulses (their sum is 1)
+  unsigned long sh_tau; // Time between two impulses, us
+  shaper_segment sh_seg[N_SHAPER_SEG]; // The last segments of the commanded motion (ring buffer)
+  byte sh_i; // The current segment in sh_seg
+  byte sh_stop; // =1 when the commanded motion stopped, and the rail is still catching up with it
+  unsigned long t_sh_stop; // Time when the commanded motion stopped
+#endif
+#ifdef STOP_AND_GO
+  byte sng_flag; // Stop-and-go continuous stacking: 0: off; 1: slowing down for the next shot; 2: exposing; 3: speeding up between the frames
+#endif
+#ifdef SERPENTINE
+  byte reverse_pass; // =1 when the current stack of a timelapse sequence is shot backwards (from point2 to point1)
+#endif
+#ifdef FAST_STARTUP
+  byte boot_flag; // 0: startup is over; 1: waiting for the rail to be ready; quick verify: 2: starting; 3: moving to the limiter; 4: stopping there; 5: moving back
+  unsigned long t_boot; // millis() at power-up
+  COORD_TYPE boot_length; // Rail length (limit2 - limit1) from the boot record, for the quick verify
+  byte boot_clean; // Copy of the EEPROM flag at ADDR_BOOT_CLEAN
+#endif
+#ifdef CAMERA_BUFFER
+  byte i_camera; // Index for the CAMERAS table (camera burst buffer model)
+  short burst_frame; // Frame counter value at which the continuous stacking slows down to the sustained frame rate
+#endif
+#ifdef IDLE_SLEEP
+  volatile byte wakeup; // =1 when a pin change interrupt (key pressed, limiter) happened during the idle sleep
+  unsigned long t_sleep; // Time spent sleeping since t_duty0, us
+  unsigned long t_duty0; // Start of the current duty cycle measurement interval
+  byte duty; // Percentage of time the MCU was awake in the last measurement interval
+#endif
+#ifdef TELEMETRY
+  unsigned long t_telemetry; // Time when the last telemetry record was generated
+  unsigned short V; // Last measured voltage per AA battery, mV
+  unsigned short skipped_steps; // Counter of skipped-step corrections
+  unsigned short dt_max; // Longest loop since the last telemetry record
+  unsigned short bad_timing_counter; // How many loops since the last telemetry record were longer than the shortest microstep interval allowed
+  byte i_timing; // 0 before the first timing() call of the current move, 1 afterwards
+  byte dropped; // Counter of telemetry records dropped because the TX buffer was full
+  volatile byte tx_head; // TX ring buffer: next byte to be written (only changed in telemetry())
+  volatile byte tx_tail; // TX ring buffer: next byte to be sent (only changed in the UART interrupt)
+  volatile byte tx_buf[TX_BUF_SIZE];
 #endif
 };
 
@@ -40,12 +40,20 @@
 #include "pcd8544.h"
 #include "stacker.h"
 #include "stdio.h"
+#include <avr/sleep.h>
 
 //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
 void setup() {
   // Should be the first line in setup():
   g.setup_flag = 1;
+#ifdef TIMER1_CLOCK
+  clock_init();
+#endif
+#ifdef RAM_DEBUG
+  // Painting the free RAM, to measure the stack high-water mark later:
+  ram_paint();
+#endif
 
   // Setting pins for EasyDriver to OUTPUT:
 #ifndef DISABLE_MOTOR
@@ -54,12 +62,54 @@ void setup() {
 #endif
   pinMode(PIN_ENABLE, OUTPUT);
   digitalWrite(PIN_ENABLE, HIGH);
+  g.driver_state = 0;
+#ifdef MICROSTEP_SWITCH
+#ifndef DISABLE_MOTOR
+  pinMode(PIN_MS, OUTPUT);
+  digitalWrite(PIN_MS, HIGH);
+#endif
+  // The driver starts at a full step position after powering up:
+  g.ms_coarse = 0;
+  g.ms_phase = 0;
+#endif
+#ifdef AXIS2
+#ifndef DISABLE_MOTOR
+  pinMode(PIN_DIR2, OUTPUT);
+  pinMode(PIN_STEP2, OUTPUT);
+#endif
+  // The lateral coordinate is counted from the position at power up:
+  g.y_moving = 0;
+  g.y_short_old = 0;
+#endif
   pinMode(PIN_LIMITERS, INPUT_PULLUP);
+#if defined(LIMITER_INT) && !defined(MOTOR_DEBUG)
+  // Pin change interrupt for the limiter pin (pin 8 = PCINT0); only the rising edge is used in the interrupt:
+  g.limit_hit = 0;
+  PCMSK0 = _BV(PCINT0);
+  PCIFR = _BV(PCIF0);
+  PCICR |= _BV(PCIE0);
+#endif
 
   pinMode(PIN_SHUTTER, OUTPUT);
   pinMode(PIN_AF, OUTPUT);
 
+#ifdef FLASH_SYNC
+  // Pin change interrupt for the flash sync pin (pin 9 = PCINT1); only the falling edge is used in the interrupt:
+  pinMode(PIN_FLASH, INPUT_PULLUP);
+  g.flash = 0;
+  PCMSK0 |= _BV(PCINT1);
+  PCIFR = _BV(PCIF0);
+  PCICR |= _BV(PCIE0);
+#elif defined(ENCODER)
+  // Pin change interrupt for the encoder channel A (pin 9 = PCINT1); both edges are counted in the interrupt:
+  pinMode(PIN_ENC_A, INPUT_PULLUP);
+  pinMode(PIN_ENC_B, INPUT_PULLUP);
+  PCMSK0 |= _BV(PCINT1);
+  PCIFR = _BV(PCIF0);
+  PCICR |= _BV(PCIE0);
+#else
   pinMode(PIN_LCD_LED, OUTPUT);
+#endif
 
 #ifndef SOFTWARE_SPI
   // My Nokia 5110 didn't work in SPI mode until I added this line (reference: http://forum.arduino.cc/index.php?topic=164108.0)
@@ -68,6 +118,10 @@ void setup() {
 #endif
   lcd.begin();  // Always call lcd.begin() first.
 
+#ifdef TELEMETRY
+  telemetry_init();
+#endif
+
   // Checking if EEPROM was never used:
   if (EEPROM.read(0) == 255 && EEPROM.read(1) == 255)
   {
@@ -84,17 +138,6 @@ void setup() {
   keypad.key[0].kstate = (KeyState)0;
   keypad.key[1].kstate = (KeyState)0;
 
-#ifdef ROUND_OFF
-  // Rounding off small values of MM_PER_FRAME to the nearest whole number of microsteps:
-  for (int i = 0; i < N_PARAMS; i++)
-  {
-    float fsteps = MM_PER_FRAME[i] / MM_PER_MICROSTEP;
-    short steps = (short)nintMy(fsteps);
-    if (steps < 20)
-      MM_PER_FRAME[i] = ((float)steps) * MM_PER_MICROSTEP;
-  }
-#endif
-
   // Should be the last line in setup:
   g.setup_flag = 0;
 }
@@ -115,17 +158,62 @@ void loop()
   // All the processing related to the two extreme limits for the macro rail movements:
   limiters();
 
+#ifdef ENCODER
+  // Comparing the commanded rail position with the encoder:
+  encoder_check();
+#endif
+
+#ifdef HOMING
+  // Slow re-approach of a limiter during calibration:
+  homing();
+#endif
+
   // Perform calibration of the limiters if requested (only when the rail is at rest):
   calibration();
 
+#ifdef FAST_STARTUP
+  // Quick verify of the rail position after power-up, and the startup time readout:
+  startup();
+#endif
+
+#ifdef BL_MAP_DEBUG
+  // Automatic backlash measurement at the limiters (if initiated):
+  backlash_measurement();
+#endif
+
+#ifdef ACCEL_TUNE
+  // Acceleration tuning for the payload (if initiated):
+  accel_tune();
+#endif
+
   // Camera control:
   camera();
 
+#ifdef AXIS2
+  COORD_TYPE pos_short_old = g.pos_short_old;
+#endif
+
+  // Powering the motor driver down once the rail is at rest (save energy mode):
+  driver_idle();
+
   // Issuing write to stepper motor driver pins if/when needed:
   motor_control();
 
-#ifdef TIMING
+#ifdef AXIS2
+  // The lateral motor, only in the loops without a step of the focusing motor:
+  if (g.pos_short_old == pos_short_old)
+    motor2_control();
+#endif
+
+#ifdef TELEMETRY
+  // Loop timing statistics, and streaming the current state:
   timing();
+  telemetry();
+#endif
+
+#ifdef IDLE_SLEEP
+  // Sleeping until the next event, if the rail is idle:
+  idle_sleep();
 #endif
 
 }
@@ -0,0 +1,164 @@
+#ifdef FAST_STARTUP
+/* Fast startup (FAST_STARTUP).
+
+   The boot record (the position and the limits, with a checksum) is saved in EEPROM every time the rail comes to rest with the backlash compensated
+   (not right before the backlash compensation move), and is marked as not clean when the rail starts moving (one byte write). At power-up:
+    - a clean record which agrees with the saved position and limits is trusted: no power-on backlash loop;
+    - a record which is not clean (the power was switched off while moving) still has the right rail length, so the position is found again by
+      touching the foreground limiter only (quick verify), the same way calibration does it for that limiter;
+    - without a good record, the usual startup is done.
+*/
+
+byte boot_checksum(byte *p, byte n)
+/* Sum of the first n bytes at p (modulo 256).
+ */
+{
+  byte sum = 0;
+  for (byte i = 0; i < n; i++)
+    sum = sum + p[i];
+  return sum;
+}
+
+
+void boot_save()
+/* Saving the clean boot record; called when the rail stopped. Not during calibration, the power-on backlash loop or the quick verify.
+ */
+{
+  if (g.calibrate || g.calibrate_flag || g.backlash_init || g.BL_counter > (COORD_TYPE)0 || g.boot_flag > 1 || g.error)
+    return;
+  // Not between the frames of a non-continuous stack (the record is saved once, at the end of the stack), to spare the EEPROM:
+  if (g.stacker_mode >= 2 && g.continuous_mode == 0)
+    return;
+  boot_record r;
+  r.pos = g.pos;
+  r.limit1 = g.limit1;
+  r.limit2 = g.limit2;
+  r.checksum = boot_checksum((byte *)&r, (byte *)&r.checksum - (byte *)&r);
+  // (only the bytes which changed are written)
+  EEPROM.put( ADDR_BOOT, r);
+  if (g.boot_clean == 0)
+  {
+    EEPROM.put( ADDR_BOOT_CLEAN, (byte)1);
+    g.boot_clean = 1;
+  }
+  return;
+}
+
+
+void boot_dirty()
+/* The rail starts moving: the boot record is not clean anymore (called from change_speed()). The flag is only written when it is set, so
+   the frame steps of a non-continuous stack (no boot_save() in between) don't write it.
+ */
+{
+  if (g.boot_clean == 0)
+    return;
+  EEPROM.put( ADDR_BOOT_CLEAN, (byte)0);
+  g.boot_clean = 0;
+  return;
+}
+
+
+byte boot_restore()
+/* Called from initialize() at power-up, after the EEPROM values were read. Returns 1 if the power-on backlash loop is not needed (the state was
+   restored from the boot record, or the quick verify will be done).
+ */
+{
+  boot_record r;
+  byte clean;
+  EEPROM.get( ADDR_BOOT, r);
+  EEPROM.get( ADDR_BOOT_CLEAN, clean);
+  g.boot_clean = clean;
+  // No good record (a factory reset, or EEPROM written by an older version of the firmware):
+  if (r.checksum != boot_checksum((byte *)&r, (byte *)&r.checksum - (byte *)&r) || r.limit2 <= r.limit1)
+    return 0;
+
+  if (clean == 1 && g.calibrate == 0 && r.pos == g.pos && r.limit1 == g.limit1 && r.limit2 == g.limit2)
+  {
+    // The rail didn't move since the record was saved (with the backlash compensated):
+    g.BL_counter = 0;
+    return 1;
+  }
+
+  // Quick verify (the backlash will be taken up by the move towards the limiter):
+  g.calibrate = 0;
+  g.limit1 = r.limit1;
+  g.boot_length = r.limit2 - r.limit1;
+  g.BL_counter = g.backlash;
+  g.boot_flag = 2;
+  return 1;
+}
+
+
+void startup()
+/* The quick verify of the rail position, and the startup time readout (called from loop()).
+ */
+{
+  if (g.boot_flag == 0 || g.error > 0)
+    return;
+
+  switch (g.boot_flag)
+  {
+    case 1: // Waiting until the rail is ready (after the power-on backlash loop, calibration, or the quick verify)
+      if (g.moving || g.started_moving || g.backlashing || g.breaking || g.calibrate || g.backlash_init || g.BL_counter > (COORD_TYPE)0)
+        return;
+      g.boot_flag = 0;
+      sprintf(g.buffer, "Ready in%5.5ss", ftoa(g.buf7, 1e-3 * (float)(millis() - g.t_boot), 1));
+      display_comment_line(g.buffer);
+      break;
+
+    case 2: // Moving towards the foreground limiter, with maximum acceleration
+      if (g.moving || g.started_moving || g.breaking)
+        return;
+      change_speed(-g.speed_limit, 0, 2);
+      letter_status("V");
+      g.boot_flag = 3;
+      break;
+
+    case 3: // Until the limiter goes on
+      if (digitalRead(PIN_LIMITERS) == HIGH)
+      {
+        g.limit_tmp = g.pos_short_old;
+        change_speed(0.0, 0, 2);
+        // This should be after change_speed(0.0):
+        g.breaking = 1;
+        g.boot_flag = 4;
+      }
+      break;
+
+    case 4: // Stopped at the limiter
+      if (g.moving || g.started_moving || g.breaking)
+        return;
+#ifdef HOMING
+      // Refining g.limit_tmp with the two-speed homing, as in calibration:
+      if (g.homing_flag == 0)
+      {
+        g.homing_dir = -1;
+        g.homing_i = 0;
+        g.homing_flag = 1;
+      }
+      if (g.homing_flag < 5)
+        return;
+      g.homing_flag = 0;
+#endif
+      // The foreground limit, as in calibration; the background one is the rail length away:
+      g.coords_change = g.limit1 - (g.limit_tmp + LIMITER_PAD);
+      g.limit1 = g.limit_tmp + LIMITER_PAD;
+      g.limit2 = g.limit1 + g.boot_length;
+      coordinate_recalibration();
+      g.coords_change = 0;
+      // Travelling back into safe area (the limiter is still on):
+      go_to((float)(g.limit1 + 2 * BREAKING_DISTANCE) + 0.5, g.speed_limit);
+      g.boot_flag = 5;
+      break;
+
+    case 5: // Back in the safe area
+      if (g.moving || g.started_moving)
+        return;
+      letter_status(" ");
+      g.boot_flag = 1;
+      break;
+  }
+
+  return;
+}
+#endif
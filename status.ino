@@ -7,36 +7,50 @@ void display_all()
  Refreshing the whole screen
  */
 {
-#ifdef TIMING
-  return;
-#endif
-
   lcd.clear();
   lcd.setCursor(0, 0);
 
   if (g.alt_flag)
   {
     // Line 1:
-    sprintf(g.buffer, "Rev=%1d    Acc=%1d", 1 - g.straight, ACCEL_FACTOR[g.i_accel_factor]);
+    sprintf(g.buffer, "Rev=%1d    Acc=%1d", (int)constrain(1 - g.straight, 0, 1), min(accel_factor(), (byte)9));
     lcd.print(g.buffer);
     // Line 2:
-    sprintf(g.buffer, "N=%-3d     BL=%1d", N_TIMELAPSE[g.i_n_timelapse], g.backlash_on);
+    sprintf(g.buffer, "N=%-3d     BL=%1d", (int)constrain(n_timelapse(), 0, 999), min(g.backlash_on, (byte)9));
     lcd.print(g.buffer);
     // Line 3:
-    sprintf(g.buf6, "dt=%ds", DT_TIMELAPSE[g.i_dt_timelapse]);
-    lcd.print(g.buf6);
+    // (g.buffer: "dt=9999s" doesn't fit into buf6)
+    sprintf(g.buffer, "dt=%ds", dt_timelapse());
+    lcd.print(g.buffer);
     sprintf(g.buffer, "Mir=%1d", g.mirror_lock);
     lcd.setCursor(9, 2);
     lcd.print(g.buffer);
     // Line 4:
-    sprintf(g.buffer, "  Save=%1d Deb=%1d", g.save_energy, g.disable_limiters);
+    sprintf(g.buffer, "  Save=%1d Deb=%1d", min(g.save_energy, (byte)9), g.disable_limiters);
     lcd.print(g.buffer);
     // Line 5:
+#ifdef RAM_DEBUG
+    display_ram();
+#elif defined(IDLE_SLEEP)
+    display_duty();
+#endif
     //    lcd.print("              ");
     lcd.setCursor(0, 5);
     // Line 6:
     sprintf(g.buffer, "         s%s", VERSION);
     lcd.print(g.buffer);
+#ifdef AXIS2
+    // Number of lateral positions in the job mode:
+    lcd.setCursor(0, 5);
+    sprintf(g.buffer, "Ny=%d", n_y());
+    lcd.print(g.buffer);
+#endif
+#ifdef JOB_QUEUE
+    // Job queue progress (jobs done / jobs in the queue):
+    lcd.setCursor(0, 5);
+    sprintf(g.buffer, "Q=%d/%d", g.job_i, g.job_n);
+    lcd.print(g.buffer);
+#endif
   }
   else
   {
@@ -56,7 +70,11 @@ void display_all()
       {
         lcd.print("  Calibration ");
         lcd.print("  required!   ");
+#ifdef ACCEL_TUNE
+        lcd.print("A: +accel tune");
+#else
         lcd.print("              ");
+#endif
         lcd.print("Press any key ");
         lcd.print("to start      ");
         lcd.print("calibration.  ");
@@ -129,7 +147,7 @@ void motion_status()
     {
       if (g.stacker_mode < 2)
         for (i = 0; i < 12; i++)
-          lcd.data(rewind_char[i]);
+          lcd.data(pgm_read_byte(&rewind_char[i]));
       else
         lcd.print("<  ");
     }
@@ -137,7 +155,7 @@ void motion_status()
     {
       if (g.stacker_mode < 2)
         for (i = 0; i < 12; i++)
-          lcd.data(forward_char[i]);
+          lcd.data(pgm_read_byte(&forward_char[i]));
       else
         lcd.print(" > ");
     }
@@ -156,10 +174,15 @@ void display_frame_counter()
   if (g.error || g.alt_flag)
     return;
   // Printing frame counter:
-  if (g.stacker_mode == 0 && g.paused == 0 || g.paused > 1)
+  if ((g.stacker_mode == 0 && g.paused == 0) || g.paused > 1)
     sprintf (g.buffer, "   0 ");
   else
+#ifdef SERPENTINE
+    // Frames of a backward stack are numbered in the forward order:
+    sprintf (g.buffer, "%4d ",  g.reverse_pass ? g.Nframes - g.frame_counter : g.frame_counter + 1);
+#else
     sprintf (g.buffer, "%4d ",  g.frame_counter + 1);
+#endif
   lcd.setCursor(5, 5);
   lcd.print (g.buffer);
 
@@ -214,25 +237,21 @@ void battery_status()
   if (g.error)
     return;
 
-#ifdef BATTERY_DEBUG
-  // Printing actual voltage per AA battery (times 100)
-  lcd.setCursor(11, 5);
-  int Vint = (int)(100.0 * V);
-  sprintf(g.buffer, "%3d", Vint);
-  lcd.print(g.buffer);
-#else
+#ifdef TELEMETRY
+  // Actual voltage per AA battery is streamed as telemetry:
+  g.V = (unsigned short)(1000.0 * V);
+#endif
+
   lcd.setCursor(12, 5);
   // A 4-level bitmap indication (between V_LOW and V_HIGH):
-  byte level = (short)((V - V_LOW) / (V_HIGH - V_LOW) * 4.0);
+  short level = (short)((V - V_LOW) / (V_HIGH - V_LOW) * 4.0);
   if (level < 0)
     level = 0;
   if (level > 3)
     level = 3;
   uint8_t i;
   for (i = 0; i < 12; i++)
-    lcd.data(battery_char[level][i]);
-
-#endif // BATTERY_DEBUG
+    lcd.data(pgm_read_byte(&battery_char[level][i]));
 
   // Disabling the rail once V goes below the critical V_LOW voltage
 #ifndef MOTOR_DEBUG
@@ -270,11 +289,11 @@ void display_u_per_f()
   if (g.error || g.alt_flag)
     return;
 
-  if (MM_PER_FRAME[g.i_mm_per_frame] >= 0.00995)
-    sprintf(g.buffer, "%4duf ", nintMy(1000.0 * MM_PER_FRAME[g.i_mm_per_frame]));
+  if (mm_per_frame() >= 0.00995)
+    sprintf(g.buffer, "%4lduf ", (long)nintMy(1000.0 * mm_per_frame()));
   else
     // +0.05 is for proper round-off:
-    sprintf(g.buffer, "%4suf ", ftoa(g.buf7, 1000.0 * MM_PER_FRAME[g.i_mm_per_frame] + 0.05, 1));
+    sprintf(g.buffer, "%4suf ", ftoa(g.buf7, 1000.0 * mm_per_frame() + 0.05, 1));
 
   lcd.setCursor(0, 2);
   lcd.print(g.buffer);
@@ -290,10 +309,10 @@ void display_fps()
 {
   if (g.error || g.alt_flag)
     return;
-  if (FPS[g.i_fps] >= 1.0)
-    sprintf(g.buffer, " %3sfps", ftoa(g.buf7, FPS[g.i_fps], 1));
+  if (fps() >= 1.0)
+    sprintf(g.buffer, " %3sfps", ftoa(g.buf7, fps(), 1));
   else
-    sprintf(g.buffer, "%4sfps", ftoa(g.buf7, FPS[g.i_fps], 2));
+    sprintf(g.buffer, "%4sfps", ftoa(g.buf7, fps(), 2));
 
   lcd.setCursor(7, 2);
   lcd.print(g.buffer);
@@ -314,12 +333,12 @@ void display_one_point_params()
     return;
 
   // +0.05 for proper round off:
-  float dx = (float)(N_SHOTS[g.i_n_shots] - 1) * MM_PER_FRAME[g.i_mm_per_frame] + 0.05;
-  short dt = (short)roundMy((float)(N_SHOTS[g.i_n_shots] - 1) / FPS[g.i_fps]);
-  if (dt < 1000.0 && dt >= 0.0)
-    sprintf(g.buf6, "%3ds", dt);
-  else if (dt < 10000.0 && dt >= 0.0)
-    sprintf(g.buf6, "%4d", dt);
+  float dx = (float)(n_shots() - 1) * mm_per_frame() + 0.05;
+  short dt = (short)roundMy(stack_time(n_shots()));
+  if (dt < 1000 && dt >= 0)
+    sprintf(g.buf6, "%3ds", (int)constrain(dt, 0, 999));
+  else if (dt < 10000 && dt >= 0)
+    sprintf(g.buf6, "%4d", (int)constrain(dt, 0, 9999));
   else
     sprintf(g.buf6, "****");
 
@@ -328,7 +347,7 @@ void display_one_point_params()
   else
     sprintf(g.buf7, "****");
 
-  sprintf(g.buffer, "%4d %4s %4s", N_SHOTS[g.i_n_shots], g.buf7 , g.buf6);
+  sprintf(g.buffer, "%4d %4.4s %4.4s", (int)constrain(n_shots(), 0, 9999), g.buf7 , g.buf6);
   lcd.setCursor(0, 0);
   lcd.print(g.buffer);
   return;
@@ -349,16 +368,16 @@ void display_two_point_params()
 
   // +0.05 for proper round off:
   float dx = MM_PER_MICROSTEP * (float)(g.point2 - g.point1) + 0.05;
-  short dt = (short)nintMy((float)(g.Nframes - 1) / FPS[g.i_fps]);
-  if (dt < 1000.0 && dt >= 0.0)
-    sprintf(g.buf6, "%3ds", dt);
-  else if (dt < 10000.0 && dt >= 0.0)
-    sprintf(g.buf6, "%4d", dt);
+  short dt = (short)nintMy(stack_time(g.Nframes));
+  if (dt < 1000 && dt >= 0)
+    sprintf(g.buf6, "%3ds", (int)constrain(dt, 0, 999));
+  else if (dt < 10000 && dt >= 0)
+    sprintf(g.buf6, "%4d", (int)constrain(dt, 0, 9999));
   else
     sprintf(g.buf6, "****");
 
   if (g.point2 >= g.point1)
-    sprintf(g.buffer, "%4d %4s %4s", g.Nframes, ftoa(g.buf7, dx, 1), g.buf6);
+    sprintf(g.buffer, "%4d %4.4s %4.4s", (int)constrain(g.Nframes, 0, 9999), ftoa(g.buf7, dx, 1), g.buf6);
   else
     sprintf(g.buffer, "**** **** ****");
   lcd.setCursor(0, 1);
@@ -400,31 +419,7 @@ void display_current_position()
  Display the current position on the transient line
  */
 {
-#ifdef CAMERA_DEBUG
-  //  return;
-#endif
-#ifdef TIMING
-  // Average loop length for the last motion, in shortest miscrostep length units *100:
-  short avr = (short)(100.0 * (float)(g.t - g.t0_timing) / (float)(g.i_timing - 1) * SPEED_LIMIT);
-  // Maximum/minimum loop lenght in the above units:
-  short max1 = (short)(100.0 * (float)(g.dt_max) * SPEED_LIMIT);
-  short min1 = (short)(100.0 * (float)(g.dt_min) * SPEED_LIMIT);
-  sprintf(g.buffer, "%4d %4d %4d", min1, avr, max1);
-  lcd.setCursor(0, 4);
-  lcd.print(g.buffer);
-  // How many times arduino loop was longer than the shortest microstep time interval; total number of arduino loops:
-  sprintf(g.buffer, "%4d %6ld   ", g.bad_timing_counter, g.i_timing);
-  lcd.setCursor(0, 5);
-  lcd.print(g.buffer);
-#ifdef MOTOR_DEBUG
-//  sprintf(g.buffer, "%4d %4d %4d", cplus2, cmax, imax);
-//  lcd.setCursor(0, 3);
-//  lcd.print(g.buffer);
-#endif
-  return;
-#endif
-
-  if (g.error || g.calibrate_warning || g.moving == 0 && g.BL_counter > (COORD_TYPE)0 || g.alt_flag)
+  if (g.error || g.calibrate_warning || (g.moving == 0 && g.BL_counter > (COORD_TYPE)0) || g.alt_flag)
     return;
 
   if (g.straight)
@@ -433,25 +428,35 @@ void display_current_position()
     g.rev_char = "R";
 
   if (g.timelapse_mode)
-    sprintf(g.buf6, "%3d", g.timelapse_counter + 1);
+    sprintf(g.buf6, "%3d", (int)constrain(g.timelapse_counter + 1, 0, 999));
   else
     sprintf(g.buf6, "   ");
 
 #ifdef BL_DEBUG
 // When debugging backlash, displays the current backlash value in microsteps
-  sprintf(g.buf6, "%3d", g.backlash);
+  sprintf(g.buf6, "%3ld", constrain((long)g.backlash, 0L, 9999L));
 #endif
 #ifdef BL2_DEBUG
 // When debugging BACKLASH_2, displays the current BACKLAS_2 value in microsteps
-  sprintf(g.buf6, "%3d", BACKLASH_2);
+  sprintf(g.buf6, "%3ld", constrain((long)BACKLASH_2, 0L, 9999L));
 #endif
 #ifdef DELAY_DEBUG
 // Delay used in mirror_lock=2 mode (electronic shutter), in 10ms units:
-  sprintf(g.buf6, "%3d", SHUTTER_ON_DELAY2/10000);
+  sprintf(g.buf6, "%3ld", constrain(SHUTTER_ON_DELAY2/10000, 0L, 9999L));
+#endif
+#ifdef SETTLE_DEBUG
+// Constant term of the settle time model, in 10ms units:
+  settle_coeffs c;
+  EEPROM.get( ADDR_SETTLE, c);
+  sprintf(g.buf6, "%3d", (int)constrain(100.0 * c.t0 + 0.5, 0, 999));
+#endif
+#ifdef SHAPER_DEBUG
+// Input shaper model:
+  sprintf(g.buf6, "%3d", g.i_shaper);
 #endif
 
   float p = MM_PER_MICROSTEP * (float)g.pos;
-  sprintf(g.buffer, "%1s %6smm %3s", g.rev_char, ftoa(g.buf7, p, 3), g.buf6);
+  sprintf(g.buffer, "%1.1s %6.6smm %3.3s", g.rev_char, ftoa(g.buf7, p, 3), g.buf6);
 
   lcd.setCursor(0, 4);
   lcd.print(g.buffer);
@@ -466,12 +471,6 @@ void display_comment_line(char const *l)
  Display a comment line briefly (then it should be replaced with display_current_positio() output)
  */
 {
-#ifdef TIMING
-  return;
-#endif
-#ifdef CAMERA_DEBUG
-  return;
-#endif
   if (g.error)
     return;
   lcd.setCursor(0, 4);
@@ -483,33 +482,32 @@ void display_comment_line(char const *l)
 //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
 
+#ifdef CAMERA_BUFFER
+void camera_buffer()
+// Fill g.buffer with the camera model parameters, to be displayed with display_comment_line:
+{
+  if (pgm_read_byte(&CAMERAS[g.i_camera].buffer) == 0)
+    snprintf(g.buffer, sizeof(g.buffer), "Cam%1d no limit ", min(g.i_camera, (byte)9));
+  else
+    snprintf(g.buffer, sizeof(g.buffer), "C%1d b%-2d %.3s/%.3s", min(g.i_camera, (byte)9), min(pgm_read_byte(&CAMERAS[g.i_camera].buffer), (uint8_t)99),
+             ftoa(g.buf7, pgm_read_float(&CAMERAS[g.i_camera].burst_fps), 1), ftoa(g.buf6, pgm_read_float(&CAMERAS[g.i_camera].sustained_fps), 1));
+  return;
+}
+#endif
+
+
 void delay_buffer()
 // Fill g.buffer with non-continuous stacking parameters, to be displayed with display_comment_line:
 {
-  float y = MM_PER_FRAME[g.i_mm_per_frame] / MM_PER_MICROSTEP / ACCEL_LIMIT;
+  float y = mm_per_frame() / MM_PER_MICROSTEP / accel_limit();
   // Time to travel one frame (s), with fixed acceleration:
   float dt_goto = 2e-6 * sqrt(y);
-  float delay1 = FIRST_DELAY[g.i_first_delay];
-  float delay2 = SECOND_DELAY[g.i_second_delay];
-  short dt = (short)nintMy((float)(g.Nframes) * (FIRST_DELAY[g.i_first_delay] + SECOND_DELAY[g.i_second_delay]) + (float)(g.Nframes - 1) * dt_goto);
-  sprintf(g.buffer, "%4s %4s %4d", ftoa(g.buf7, delay1, 1), ftoa(g.buf6, delay2, 1), dt);
+  float delay1 = first_delay();
+  float delay2 = second_delay();
+  short dt = (short)nintMy((float)(g.Nframes) * (first_delay() + second_delay()) + (float)(g.Nframes - 1) * dt_goto);
+  sprintf(g.buffer, "%4.4s %4.4s %4d", ftoa(g.buf7, delay1, 1), ftoa(g.buf6, delay2, 1), (int)constrain(dt, 0, 9999));
 
   return;
 }
 //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-
-#ifdef CAMERA_DEBUG
-void AF_status(short s)
-{
-  lcd.setCursor(12, 4);
-  lcd.print(s);
-  return;
-}
-void shutter_status(short s)
-{
-  lcd.setCursor(13, 4);
-  lcd.print(s);
-  return;
-}
-#endif
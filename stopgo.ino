@@ -0,0 +1,71 @@
+#ifdef STOP_AND_GO
+/* Stop-and-go continuous stacking: the rail moves to the end of the stack in one go_to() move, as usual, but its target speed is changed for every
+   frame. The frame is shot at STOP_AND_GO_SPEED, which is kept until the end of the exposure window; then the rail speeds up, and slows down
+   again just in time to reach the next frame position at STOP_AND_GO_SPEED. The acceleration in both cases is g.accel_v[3] (accel_limit() / accel_factor).
+*/
+
+float sng_peak_speed()
+/* Peak speed between the current and the next frame, such that the next frame is reached one frame period after the last shot (or as soon as
+   possible, if it's too late for that).
+ */
+{
+  float a = g.accel_v[3];
+  float v = STOP_AND_GO_SPEED;
+#ifdef CAMERA_BUFFER
+  float f = camera_fps(g.frame_counter >= g.burst_frame);
+#else
+  float f = fps();
+#endif
+  // Distance and time left until the next frame:
+  float d = (float)g.pos_to_shoot - g.pos;
+  float dt = 1e6 / f - (float)(g.t - g.t_shot);
+  // Accelerating from v to u, and decelerating back to v, covers d in dt if u^2 - 2*b*u + c = 0:
+  float b = v + 0.5 * a * dt;
+  float c = a * d + v * v;
+  float D = b * b - c;
+  float u;
+  if (dt <= 0.0 || D < 0.0)
+    // No cruising at all (the frame will be late):
+    u = sqrt(c);
+  else
+    u = b - sqrt(D);
+  if (u < v)
+    u = v;
+  if (u > g.speed_limit)
+    u = g.speed_limit;
+  return u;
+}
+
+
+void stop_and_go()
+/* Called from camera() in every loop: changing the target speed of the rail during a continuous stack.
+ */
+{
+  if (g.sng_flag == 0 || g.stacker_mode < 2 || g.start_stacking != 3 || g.moving == 0 || g.breaking || g.paused)
+    return;
+  // The rail is already stopping at the end of the go_to() move:
+  if (g.speed1 < SPEED_TINY)
+    return;
+
+  if (g.sng_flag == 2)
+  {
+    // The exposure is over; speeding up towards the next frame:
+    if (g.make_shot == 0 && g.t - g.t_shutter >= STOP_AND_GO_EXPOSURE_US)
+    {
+      change_speed(sng_peak_speed(), 1, 1);
+      g.sng_flag = 3;
+    }
+  }
+  else if (g.sng_flag == 3)
+  {
+    // Distance needed to slow down to STOP_AND_GO_SPEED, plus the distance travelled in one loop (so the slowing down starts early rather than late):
+    float d = 0.5 * (g.speed * g.speed - STOP_AND_GO_SPEED * STOP_AND_GO_SPEED) / g.accel_v[3] + g.speed * (float)(g.t - g.t_old);
+    if ((float)g.pos_to_shoot - g.pos <= d)
+    {
+      change_speed(STOP_AND_GO_SPEED, 1, 1);
+      g.sng_flag = 1;
+    }
+  }
+  return;
+}
+#endif
@@ -0,0 +1,107 @@
+/* Live telemetry: fixed-size binary records (struct telemetry_record) streamed over the UART TX line.
+
+   Records are copied into a TX ring buffer (g.tx_buf) which is drained by the UART "data register empty" interrupt,
+   one byte per interrupt. Nothing here ever waits for the UART: if the buffer doesn't have room for a whole record,
+   the record is dropped (and counted in g.dropped).
+   Don't use the Arduino Serial object together with TELEMETRY (it would define the same interrupt).
+ */
+
+#ifdef TELEMETRY
+void telemetry_init()
+// UART setup: 8N1, transmitter only (pin 0 stays a normal digital pin, used by PIN_STEP)
+{
+  g.tx_head = 0;
+  g.tx_tail = 0;
+  g.dropped = 0;
+  g.skipped_steps = 0;
+  g.dt_max = 0;
+  g.bad_timing_counter = 0;
+  g.t_telemetry = clock_us();
+  // Double speed mode (same baud rate formula as in the Arduino core):
+  UCSR0A = _BV(U2X0);
+  UBRR0 = (F_CPU / 4 / TELEMETRY_BAUD - 1) / 2;
+  UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+  UCSR0B = _BV(TXEN0);
+  return;
+}
+
+
+void telemetry()
+/* Generating a telemetry record every TELEMETRY_DT microseconds, and placing it into the TX ring buffer.
+ */
+{
+  struct telemetry_record r;
+  byte *p;
+  byte i, free_bytes, sum;
+
+  if (g.t - g.t_telemetry < TELEMETRY_DT)
+    return;
+  g.t_telemetry = g.t;
+
+  r.sync[0] = 0xA5;
+  r.sync[1] = 0x5A;
+  r.t = g.t;
+  r.pos = g.pos;
+  r.speed = g.speed;
+  r.accel = g.accel;
+  r.stacker_mode = g.stacker_mode;
+  r.frame_counter = g.frame_counter;
+  r.V = g.V;
+  r.skipped_steps = g.skipped_steps;
+  r.dt_max = g.dt_max;
+  r.bad_timing_counter = g.bad_timing_counter;
+  r.flags = g.moving | (g.AF_on << 1) | (g.shutter_on << 2) | (g.breaking << 3) | (g.backlashing << 4) | ((g.paused > 0) << 5);
+#ifdef SERPENTINE
+  r.flags |= g.reverse_pass << 6;
+#endif
+  r.dropped = g.dropped;
+  // The loop statistics are per record:
+  g.dt_max = 0;
+  g.bad_timing_counter = 0;
+
+  // Free space in the ring buffer (one byte is always kept empty, to tell a full buffer from an empty one):
+  free_bytes = (TX_BUF_SIZE - 1) - ((g.tx_head - g.tx_tail) & (TX_BUF_SIZE - 1));
+  if (free_bytes < sizeof(r))
+  {
+    g.dropped++;
+    return;
+  }
+
+  p = (byte *)&r;
+  sum = 0;
+  for (i = 2; i < sizeof(r) - 1; i++)
+    sum = sum + p[i];
+  r.checksum = sum;
+
+  byte head = g.tx_head;
+  for (i = 0; i < sizeof(r); i++)
+  {
+    g.tx_buf[head] = p[i];
+    head = (head + 1) & (TX_BUF_SIZE - 1);
+  }
+  // Publishing the new record to the interrupt (single byte write, so atomic):
+  g.tx_head = head;
+  // Enabling the "data register empty" interrupt (UCSR0B is also modified inside the interrupt):
+  noInterrupts();
+  UCSR0B |= _BV(UDRIE0);
+  interrupts();
+
+  return;
+}
+
+
+ISR(USART_UDRE_vect)
+// Sending the next byte from the TX ring buffer; disabling itself once the buffer is empty
+{
+  byte tail = g.tx_tail;
+  if (tail != g.tx_head)
+  {
+    UDR0 = g.tx_buf[tail];
+    tail = (tail + 1) & (TX_BUF_SIZE - 1);
+    g.tx_tail = tail;
+  }
+  if (tail == g.tx_head)
+    UCSR0B &= ~_BV(UDRIE0);
+}
+#endif
+
@@ -0,0 +1,195 @@
+#ifdef ACCEL_TUNE
+/* Acceleration tuning for the payload (ACCEL_TUNE), initiated with "A" on the calibration warning screen ("#C"): it starts once the full calibration
+   is done.
+
+   The foreground limiter position is found first (the reference): the rail moves towards the limiter until it goes on (as in the quick verify of
+   FAST_STARTUP, so it is found however many steps were lost), and then homes it. Then, for each acceleration of the TUNED_ACCEL table, from the
+   smallest one, the rail makes ACCEL_TUNE_MOVES round trips between the soft limits (the whole moves, including their backlash compensation legs,
+   are done at that acceleration), and the limiter position is found again. A motor which lost steps has the limiter in a different place: the rail
+   coordinates are corrected, and the largest acceleration tested before that one becomes the tuned one. Everything except for the test moves is
+   done at the smallest acceleration, and the homing approaches are all made at the same slow speed and in the same direction, so the backlash and
+   the limiter hysteresis are the same every time.
+ */
+
+void tune_next()
+/* Starting the test moves at the acceleration g.tune_i.
+ */
+{
+  g.i_accel_tune = g.tune_i;
+  set_accel_v();
+  g.tune_n = 0;
+  sprintf(g.buffer, "Test x%-7s ", ftoa(g.buf7, 0.25 * (float)pgm_read_byte(&TUNED_ACCEL[g.tune_i]), 2));
+  display_comment_line(g.buffer);
+  g.tune_flag = 5;
+  return;
+}
+
+
+void accel_tune()
+/* The acceleration tuning state machine (called from loop()).
+ */
+{
+  COORD_TYPE lost;
+  float speed;
+
+  if (g.tune_flag == 0)
+    return;
+
+  if (g.tune_flag == 7)
+    // Waiting for the full calibration (done at the smallest acceleration) to finish, and for the rail to come to rest after it:
+  {
+    if (g.error > 0)
+      g.tune_flag = 6;
+    else if (g.calibrate > 0 || g.moving || g.started_moving || g.backlashing || g.breaking || g.update_pending)
+      return;
+    else
+    {
+      g.tune_flag = 1;
+      display_comment_line("Accel tuning  ");
+    }
+  }
+
+  if ((g.error > 0 || g.calibrate > 0) && g.tune_flag < 6)
+    // Something else took over (e.g., we hit a limiter during a test move); giving up:
+  {
+#ifdef HOMING
+    g.homing_flag = 0;
+#endif
+    g.tune_flag = 6;
+  }
+
+  // Polling the limiter while approaching it:
+  if (g.tune_flag == 2)
+  {
+    if (digitalRead(PIN_LIMITERS) == HIGH)
+    {
+      g.limit_tmp = g.pos_short_old;
+      change_speed(0.0, 0, 2);
+      // This should be after change_speed(0.0):
+      g.breaking = 1;
+      g.tune_flag = 3;
+    }
+    return;
+  }
+
+  // Everything else is only done at rest (homing handles its own moves):
+  if (g.moving || g.started_moving || g.backlashing || g.breaking)
+    return;
+
+  switch (g.tune_flag)
+  {
+    case 1: // Moving towards the foreground limiter at the smallest acceleration, and slow enough to stop within BREAKING_DISTANCE after it
+      g.i_accel_tune = 0;
+      set_accel_v();
+      speed = sqrt(2.0 * accel_limit() * BREAKING_DISTANCE);
+      if (speed > g.speed_limit)
+        speed = g.speed_limit;
+      change_speed(-speed, 0, 2);
+      letter_status("T");
+      g.tune_flag = 2;
+      break;
+
+    case 3: // Stopped at the limiter: homing, then comparing the limiter position with the reference
+      if (g.homing_flag == 0)
+      {
+        g.homing_dir = -1;
+        g.homing_i = 0;
+        g.homing_flag = 1;
+      }
+      if (g.homing_flag < 5)
+        return;
+      g.homing_flag = 0;
+      if (g.homing_i < N_HOMING)
+        // The homing failed:
+      {
+        g.tune_flag = 6;
+        return;
+      }
+
+      if (g.tune_n == 0)
+        // The reference position; testing the smallest acceleration first:
+      {
+        g.tune_ref = g.limit_tmp;
+        g.tune_i = 0;
+        g.tune_best = N_TUNED_ACCEL;
+      }
+      else
+      {
+        lost = abs(g.limit_tmp - g.tune_ref);
+        if (lost <= ACCEL_TUNE_TOL)
+        {
+          g.tune_best = g.tune_i;
+          g.tune_i++;
+        }
+        else
+          // Lost steps: the rail coordinates are shifted back to the reference (coordinate_recalibration() shifts the limits as well, but
+          // they are still where they were), and no more tests:
+        {
+          g.coords_change = g.tune_ref - g.limit_tmp;
+          g.limit1 = g.limit1 - g.coords_change;
+          g.limit2 = g.limit2 - g.coords_change;
+          coordinate_recalibration();
+          g.coords_change = 0;
+          g.tune_i = N_TUNED_ACCEL;
+        }
+        if (g.tune_i == N_TUNED_ACCEL)
+          // Done: the largest acceleration without lost steps (or the smallest one, if they all lost steps):
+        {
+          if (g.tune_best < N_TUNED_ACCEL)
+            g.i_accel_tune = g.tune_best;
+          else
+            g.i_accel_tune = 0;
+          set_accel_v();
+          EEPROM.put( ADDR_I_ACCEL_TUNE, g.i_accel_tune);
+        }
+      }
+      // Travelling back into safe area (the limiter is still on):
+      go_to((float)(g.limit1 + 2 * BREAKING_DISTANCE) + 0.5, g.speed_limit);
+      g.tune_flag = 4;
+      break;
+
+    case 4: // Back in the safe area: the next test, or the result
+      if (g.BL_counter > (COORD_TYPE)0)
+        return;
+      if (g.tune_i < N_TUNED_ACCEL)
+      {
+        tune_next();
+        return;
+      }
+      g.tune_flag = 0;
+      letter_status(" ");
+      if (g.tune_best < N_TUNED_ACCEL)
+        sprintf(g.buffer, "Accel x%-6s ", ftoa(g.buf7, 0.25 * (float)pgm_read_byte(&TUNED_ACCEL[g.i_accel_tune]), 2));
+      else
+        sprintf(g.buffer, "Lost steps!   ");
+      display_comment_line(g.buffer);
+      break;
+
+    case 5: // Test moves between the soft limits (once the backlash is compensated), then back to the limiter
+      if (g.BL_counter > (COORD_TYPE)0)
+        return;
+      if (g.tune_n < 2 * ACCEL_TUNE_MOVES)
+      {
+        if (g.tune_n % 2 == 0)
+          go_to((float)(g.limit2 - 2 * BREAKING_DISTANCE) + 0.5, g.speed_limit);
+        else
+          go_to((float)(g.limit1 + 2 * BREAKING_DISTANCE) + 0.5, g.speed_limit);
+        g.tune_n++;
+        return;
+      }
+      g.tune_flag = 1;
+      break;
+
+    case 6: // Aborted: back to the saved acceleration
+      EEPROM.get( ADDR_I_ACCEL_TUNE, g.i_accel_tune);
+      set_accel_v();
+      g.tune_flag = 0;
+      if (g.calibrate == 0)
+        letter_status(" ");
+      display_comment_line("Tuning aborted");
+      break;
+  }
+
+  return;
+}
+#endif